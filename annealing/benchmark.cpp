@@ -0,0 +1,208 @@
+#include "src/annealing.h"
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Микробенчмарки горячего пути отжига на сетке (n, k) как в experiment.py.
+// Сборка: make benchmark, для AVX2-ядра блочной оценки make AVX2=1 benchmark
+// (остальные варианты - в Makefile).
+// JSON для отслеживания регрессий: ./benchmark --benchmark_out=bench.json
+//                                              --benchmark_out_format=json
+// items_per_second в отчёте - операции (шаги, ходы, кадры) в секунду.
+
+namespace {
+    // Как input/generator.py: длительности равномерно из [10, 100].
+    std::shared_ptr<const Instance> make_instance(int n, int k) {
+        Xoshiro256 gen(n * 1000 + k);
+        std::vector<std::int32_t> works(n);
+        for (std::int32_t& work : works) {
+            work = 10 + gen.below(91);
+        }
+        return std::make_shared<const Instance>(k, std::move(works));
+    }
+
+    // Решение после случайного перемешивания, чтобы очереди были разной длины.
+    ImplAnnealingSolution make_solution(int n, int k) {
+        ImplAnnealingSolution solution = ImplAnnealingSolution(make_instance(n, k));
+        ImplMutateSolution mut = ImplMutateSolution(1);
+        for (int i = 0; i < 10 * n; ++i) {
+            mut.propose(&solution);
+            mut.apply(&solution);
+        }
+        mut.clear_journal();
+        return solution;
+    }
+
+    void grid(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"n", "k"});
+        b->ArgsProduct({{300, 1500, 6000}, {2, 8, 20}});
+    }
+}
+
+
+static void BM_GetLossMetric(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    const AnnealingSolution* base = &solution;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base->get_loss_metric());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetLossMetric)->Apply(grid);
+
+// Старый протокол: копия решения и случайный ход в копии.
+static void BM_MutateCopy(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplAnnealingSolution new_solution = solution;
+    ImplMutateSolution mut = ImplMutateSolution(2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mut(&solution, &new_solution));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutateCopy)->Apply(grid);
+
+// Инкрементальный протокол: оценка хода без применения.
+static void BM_Propose(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplMutateSolution mut = ImplMutateSolution(3);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mut.propose(&solution));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Propose)->Apply(grid);
+
+static void BM_ProposeApply(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplMutateSolution mut = ImplMutateSolution(4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mut.propose(&solution));
+        mut.apply(&solution);
+        mut.clear_journal();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProposeApply)->Apply(grid);
+
+// Смесь видов ходов, как experiment --moves end=1,swap=1,exchange=1,relocate=0.05.
+static void BM_ProposeApplyMixed(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplMutateSolution mut = ImplMutateSolution(4);
+    mut.set_move_weights(ImplMutateSolution::MoveWeights::parse("end=1,swap=1,exchange=1,relocate=0.05"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mut.propose(&solution));
+        mut.apply(&solution);
+        mut.clear_journal();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProposeApplyMixed)->Apply(grid);
+
+// Блочная оценка MutateSolution::MAX_BLOCK ходов; items - ходы.
+static void BM_ProposeBlock(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplMutateSolution mut = ImplMutateSolution(3);
+    long long deltas[MutateSolution::MAX_BLOCK];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mut.propose_block(&solution, deltas, MutateSolution::MAX_BLOCK));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * MutateSolution::MAX_BLOCK);
+}
+BENCHMARK(BM_ProposeBlock)->Apply(grid);
+
+static void BM_Assign(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplAnnealingSolution copy = solution;
+    AnnealingSolution& base = copy;
+    for (auto _ : state) {
+        base = solution;
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Assign)->Apply(grid);
+
+// Полный шаг движка (CONFIG::STEPS_WITHOUT_TEMP_DECREASE ходов и понижение
+// температуры) в типизированном и в абстрактном варианте и с блоками по Block ходов.
+template <class Solution, class Mutation, class Law, int Block = 1>
+static void BM_AnnealingStep(benchmark::State& state) {
+    CONFIG::MOVE_BLOCK_SIZE = Block;
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(make_solution(state.range(0), state.range(1)));
+    ImplAnnealingSolution* best_solution = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mut = ImplMutateSolution();
+    BoltzmannLaw law = BoltzmannLaw();
+    BasicSimulateAnnealing<Solution, Mutation, Law> sim(solution, best_solution, mut, law, 1000);
+    sim.seed(5);
+    for (auto _ : state) {
+        sim.step();
+    }
+    state.SetItemsProcessed(state.iterations() * CONFIG::STEPS_WITHOUT_TEMP_DECREASE);
+    sim.clear();
+    CONFIG::MOVE_BLOCK_SIZE = 1;
+}
+BENCHMARK(BM_AnnealingStep<ImplAnnealingSolution, ImplMutateSolution, BoltzmannLaw>)->Apply(grid);
+BENCHMARK(BM_AnnealingStep<ImplAnnealingSolution, ImplMutateSolution, BoltzmannLaw, 32>)->Apply(grid);
+BENCHMARK(BM_AnnealingStep<AnnealingSolution, MutateSolution, LowerTemperature>)->Apply(grid);
+
+// Холодная цепочка с блоками по MutateSolution::MAX_BLOCK ходов, оценка
+// блока в threads потоках (1 - без спекуляции). Старт с оптимального SPT
+// при низкой температуре: почти все ходы отвергаются, блоки полные.
+// Траектории при любом threads одинаковы, так что разница во времени -
+// выигрыш команды за вычетом её раундов. items - ходы.
+static void BM_Speculation(benchmark::State& state) {
+    CONFIG::MOVE_BLOCK_SIZE = MutateSolution::MAX_BLOCK;
+    auto instance = make_instance(state.range(0), 20);
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(ImplAnnealingSolution::initial(instance, "spt"));
+    ImplAnnealingSolution* best_solution = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mut = ImplMutateSolution();
+    BoltzmannLaw law = BoltzmannLaw();
+    BasicSimulateAnnealing sim(solution, best_solution, mut, law, 1);
+    sim.seed(6);
+    sim.set_speculation(state.range(1));
+    for (auto _ : state) {
+        sim.step();
+    }
+    state.SetItemsProcessed(state.iterations() * CONFIG::STEPS_WITHOUT_TEMP_DECREASE);
+    sim.clear();
+    CONFIG::MOVE_BLOCK_SIZE = 1;
+}
+BENCHMARK(BM_Speculation)->ArgNames({"n", "threads"})->ArgsProduct({{6000, 1000000}, {1, 2, 4}})->UseRealTime();
+
+static void BM_SerializeRoundTrip(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplAnnealingSolution received = solution;
+    std::vector<char> frame(solution.serialized_size());
+    for (auto _ : state) {
+        solution.serialize(frame.data());
+        received.deserialize(frame.data(), frame.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_SerializeRoundTrip)->Apply(grid);
+
+// to_bytes / from_bytes через pipe; буфер pipe увеличен, чтобы кадр
+// помещался целиком и запись не блокировалась.
+static void BM_BytesRoundTrip(benchmark::State& state) {
+    ImplAnnealingSolution solution = make_solution(state.range(0), state.range(1));
+    ImplAnnealingSolution received = solution;
+    int fds[2];
+    if (pipe(fds) == -1) {
+        state.SkipWithError("pipe failed");
+        return;
+    }
+    fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+    for (auto _ : state) {
+        solution.to_bytes(fds[1]);
+        received.from_bytes(fds[0]);
+    }
+    close(fds[0]);
+    close(fds[1]);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * solution.serialized_size());
+}
+BENCHMARK(BM_BytesRoundTrip)->Apply(grid);
+
+BENCHMARK_MAIN();
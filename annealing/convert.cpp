@@ -0,0 +1,24 @@
+#include "src/instance.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Переводит экземпляр из CSV (k,d1,d2,...) в бинарный формат Instance,
+// который experiment и experiment_paral отображают в память без разбора.
+int main (int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.csv output.bin\n";
+        exit(1);
+    }
+
+    try {
+        std::shared_ptr<const Instance> instance = Instance::from_csv(argv[1]);
+        instance->save_binary(argv[2]);
+        std::cout << instance->procs() << ' ' << instance->size() << '\n';
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "src/service.h"
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+    SolverService* service = nullptr;
+
+    void on_signal(int) {
+        if (service != nullptr) {
+            service->stop();
+        }
+    }
+}
+
+int main (int argc, char *argv[]) {
+    // Резидентный решатель: ./daemon socket_path [threads]. Протокол описан
+    // в src/service.h, клиент на Python - solve_on_daemon в experiment.py.
+    // SIGINT и SIGTERM прерывают идущие прогоны и завершают процесс.
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " socket_path [threads]\n";
+        exit(1);
+    }
+    std::string socket_path = argv[1];
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc >= 3) {
+        threads = std::stoi(argv[2]);
+    }
+    if (threads < 1) {
+        std::cerr << "threads must be positive\n";
+        exit(1);
+    }
+
+    // Объявлен раньше решателя, чтобы напечатать сводку после его потоков.
+    ProfileReport profile;
+    SolverService solver(threads);
+    service = &solver;
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    try {
+        solver.serve(socket_path);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
+    service = nullptr;
+
+    return 0;
+}
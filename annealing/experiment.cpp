@@ -1,52 +1,188 @@
 #include "src/annealing.h"
+#include <condition_variable>
+#include <csignal>
 #include <fstream>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
-int main (int argc, char *argv[]) {
-    std::string input_file = argv[1];
+namespace {
+    // Ctrl-C прерывает прогон, результат - лучшее найденное к этому моменту.
+    CancellationToken interrupt;
 
-    std::string law_type = "mixed";
-    if (argc == 3) {
-        law_type = argv[2];
+    void on_interrupt(int) {
+        interrupt.cancel();
     }
+}
 
-    std::ifstream my_file(input_file);
-
-    if (!my_file.is_open()) {
-        std::cerr << "Can't open file\n";
+int main (int argc, char *argv[]) {
+    // --seed N делает запуск воспроизводимым, --telemetry file.json|file.csv
+    // сохраняет статистику прогона, --block N оценивает ходы блоками по N,
+    // --moves end=1,swap=0.5,... задаёт вероятности видов ходов,
+    // --init single|spt|lpt|greedy - начальное расписание, --gap X -
+    // остановка при отклонении от оптимума не больше X, --checkpoint file
+    // сохраняет состояние каждые --checkpoint-every итераций и продолжает
+    // прерванный прогон из file, --deadline S ограничивает прогон S секундами,
+    // --progress раз в секунду печатает в stderr лучшую метрику идущего
+    // прогона, --speculate T оценивает блоки ходов (--block) в T потоках,
+    // остальные аргументы позиционные.
+    std::vector<std::string> args;
+    std::uint64_t seed = random_seed();
+    std::string moves;
+    std::string init = "single";
+    std::string checkpoint_file;
+    // Точка пишется синхронно за O(n): ~15 мкс при n = 1500, ~7.5 мс
+    // при n = 10^6, тогда как итерация - 0.1-1 мкс. Интервал меньше n
+    // итераций заметно замедляет прогон на больших экземплярах.
+    long long checkpoint_every = 10000;
+    std::string telemetry_file;
+    double deadline = 0;
+    bool progress = false;
+    int speculate = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--moves" && i + 1 < argc) {
+            moves = argv[++i];
+        } else if (arg == "--init" && i + 1 < argc) {
+            init = argv[++i];
+        } else if (arg == "--gap" && i + 1 < argc) {
+            CONFIG::OPTIMALITY_GAP = std::stod(argv[++i]);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_file = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            checkpoint_every = std::stoll(argv[++i]);
+        } else if (arg == "--telemetry" && i + 1 < argc) {
+            telemetry_file = argv[++i];
+        } else if (arg == "--deadline" && i + 1 < argc) {
+            deadline = std::stod(argv[++i]);
+        } else if (arg == "--progress") {
+            progress = true;
+        } else if (arg == "--speculate" && i + 1 < argc) {
+            speculate = std::stoi(argv[++i]);
+        } else if (arg == "--block" && i + 1 < argc) {
+            CONFIG::MOVE_BLOCK_SIZE = std::stoi(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (checkpoint_every <= 0) {
+        std::cerr << "--checkpoint-every must be positive\n";
+        exit(1);
+    }
+    if (speculate < 1) {
+        std::cerr << "--speculate must be positive\n";
+        exit(1);
+    }
+    if (speculate > 1 && CONFIG::MOVE_BLOCK_SIZE <= 1) {
+        std::cerr << "--speculate needs --block N with N > 1\n";
         exit(1);
     }
+    if (args.empty()) {
+        std::cerr << "usage: " << argv[0] << " input [law] [options]\n";
+        exit(1);
+    }
+    std::cerr << "seed: " << seed << '\n';
 
-    int k;
-    int task;
-    char buf;
-    my_file >> k;
-    my_file >> buf;
+    std::string input_file = args[0];
 
-    std::vector<int> tasks;
+    std::string law_type = "mixed";
+    if (args.size() == 2) {
+        law_type = args[1];
+    }
 
-    while (my_file >> task) {
-        tasks.push_back(task);
-        my_file >> buf;
+    std::shared_ptr<const Instance> instance;
+    try {
+        // Бинарный экземпляр отображается в память, CSV разбирается через from_chars.
+        instance = Instance::load(input_file);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
     }
 
-    ImplAnnealingSolution* ann = new ImplAnnealingSolution(k, tasks);
-    ImplAnnealingSolution* best_ann = new ImplAnnealingSolution(*ann);
-    ImplAnnealingSolution* new_ann = new ImplAnnealingSolution(*ann);
+    ImplAnnealingSolution* ann = nullptr;
     ImplMutateSolution mut = ImplMutateSolution();
+    try {
+        ann = new ImplAnnealingSolution(ImplAnnealingSolution::initial(instance, init));
+        if (!moves.empty()) {
+            mut.set_move_weights(ImplMutateSolution::MoveWeights::parse(moves));
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
+    ImplAnnealingSolution* best_ann = new ImplAnnealingSolution(*ann);
+
+    ProfileReport profile;
+    visit_law(law_type, [&](auto& law) {
+        BasicSimulateAnnealing sim = BasicSimulateAnnealing(ann, best_ann, mut, law, 1000);
+        sim.seed(seed);
+        sim.set_speculation(speculate);
+        SnapshotFile* snapshot = nullptr;
+        if (!checkpoint_file.empty()) {
+            try {
+                snapshot = new SnapshotFile(checkpoint_file, sim.checkpoint_size());
+                if (sim.load_checkpoint(*snapshot)) {
+                    std::cerr << "resumed at iteration " << sim.get_iterations() << '\n';
+                }
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << '\n';
+                exit(1);
+            }
+            sim.set_checkpoint(snapshot, checkpoint_every);
+        }
+        if (deadline > 0) {
+            sim.set_deadline(std::chrono::steady_clock::now()
+                             + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(deadline)));
+        }
+        std::signal(SIGINT, on_interrupt);
+        sim.set_cancellation(&interrupt);
 
-    LowerTemperature* law;
-    if (law_type == "boltzmann") {
-        law = new BoltzmannLaw();
-    } else if (law_type == "cauchy") {
-        law = new CauchyLaw();
-    } else {
-        law = new MixedLaw();
-    }
-    SimulateAnnealing sim = SimulateAnnealing(ann, best_ann, new_ann, mut, *law, 1000);
-    sim.simulate_annealing();
-    sim.print_loss();
-    sim.clear();
+        BestSnapshot best(ann->serialized_size());
+        std::mutex m;
+        std::condition_variable wake;
+        bool finished = false;
+        std::thread reporter;
+        if (progress) {
+            sim.set_best_snapshot(&best);
+            reporter = std::thread([&]() {
+                auto started = std::chrono::steady_clock::now();
+                std::unique_lock lock(m);
+                while (!wake.wait_for(lock, std::chrono::seconds(1), [&]() {return finished;})) {
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+                    std::cerr << elapsed.count() << "s best " << best.loss() << '\n';
+                }
+            });
+        }
+        sim.simulate_annealing();
+        {
+            std::lock_guard lock(m);
+            finished = true;
+        }
+        wake.notify_one();
+        if (reporter.joinable()) {
+            reporter.join();
+        }
+        std::signal(SIGINT, SIG_DFL);
+        sim.print_loss();
+        // stdout разбирает experiment.py, память - в stderr.
+        std::cerr << "memory per chain: " << sim.get_memory_usage() / double(1 << 20)
+                  << " MiB, shared instance: " << instance->size() * sizeof(std::int32_t) / double(1 << 20)
+                  << " MiB\n";
+        if (!telemetry_file.empty()) {
+            std::ofstream out(telemetry_file);
+            if (telemetry_file.ends_with(".csv")) {
+                sim.get_telemetry().write_csv(out);
+            } else {
+                sim.get_telemetry().write_json(out);
+            }
+        }
+        sim.clear();
+        delete snapshot;
+    });
 
     return 0;
 }
@@ -1,11 +1,47 @@
 import input.generator as generator
+import csv
 import subprocess
+import socket
+import struct
 import time
 import pickle
 import numpy as np
 import matplotlib.pyplot as plt
 
 
+# Клиент резидентного решателя ./daemon, формат - src/service.h.
+DAEMON_REQUEST = struct.Struct('=8sQIIQQIIII')
+DAEMON_RESPONSE = struct.Struct('=8sQIIqqqqqdQ')
+DAEMON_LAWS = ['mixed', 'boltzmann', 'cauchy', 'adaptive']
+
+
+def recv_exact(sock, size):
+    data = b''
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("daemon closed the connection")
+        data += chunk
+    return data
+
+
+def solve_on_daemon(socket_path, k, works, law='mixed', seed=0, deadline_ms=0):
+    """Returns (loss, iterations, seconds) of one run on a running ./daemon."""
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(socket_path)
+        header = DAEMON_REQUEST.pack(b'ANNREQ1\0', 1, k, DAEMON_LAWS.index(law), len(works),
+                                     seed, 0, deadline_ms, 0, 0)
+        sock.sendall(header + struct.pack(f'={len(works)}i', *works))
+        while True:
+            (_, _, kind, _, loss, _, iterations, _, _, seconds,
+             frame_size) = DAEMON_RESPONSE.unpack(recv_exact(sock, DAEMON_RESPONSE.size))
+            if kind == 2:
+                raise ValueError("daemon rejected the request")
+            if kind == 0:
+                recv_exact(sock, frame_size)
+                return loss, iterations, seconds
+
+
 def experiment1():
     print("Experiment 1: finding parameters with running time > 60s")
 
@@ -61,38 +97,29 @@ def experiment3():
     procs = [2, 4, 6, 8, 10, 12, 14, 16, 18, 20]
     tasks = [300 * i for i in range(1, 21)]
 
-    # procs = [2, 4, 6]
-    # tasks = [300 * i for i in range(1, 3)]
-
+    # Вся сетка - один запуск ./sweep: экземпляры генерируются в памяти.
+    # Карта строится по времени прогона, поэтому прогоны идут в одном потоке:
+    # параллельные прогоны делят кэш и полосу памяти, и время каждого растёт.
+    # Время меряется внутри процесса, без запуска и чтения входа, которые
+    # входили в прежние замеры по ./experiment.
+    sweep_file = 'output/sweep_ex3.csv'
+    subprocess.run(f"./sweep --k {','.join(map(str, procs))} --n {','.join(map(str, tasks))} "
+                   f"--laws boltzmann --reps {mean_runs} --threads 1 --out {sweep_file}",
+                   shell=True, check=True)
 
     res = np.zeros(len(procs) * len(tasks)).reshape(len(procs), len(tasks))
-    for i, proc in enumerate(procs):
-        for j, task_num in enumerate(tasks):
-            run_time = 0
-            file_name = f'input/input_ex3_k{proc}_n{task_num}.csv'
-            generator.generator(proc, task_num, 10, 100, file_name)
-
-            print(f"Runs for proc_num {proc}, task_num {task_num}")
-            for k in range(mean_runs):
-                print(f"  Run {k}")
-                st = time.time()
-                p = subprocess.run(f"./experiment {file_name} boltzmann", shell=True, capture_output=True,
-                                   encoding='utf8')
-                dur = time.time() - st
-                run_time += dur
-                print(f"    time: {dur:.2f}")
-
-            mean_run_time = run_time / mean_runs
-            res[i, j] = mean_run_time
-
-            print(f"mean time over {mean_runs} runs: {mean_run_time:.2f}")
-            print()
+    with open(sweep_file) as f:
+        for row in csv.DictReader(f):
+            i = procs.index(int(row['k']))
+            j = tasks.index(int(row['n']))
+            res[i, j] += float(row['seconds']) / mean_runs
 
     with open('output/heat_map_data.pkl', 'wb') as f:
         pickle.dump(res, f)
 
     print("Experiment 3 finished!")
     print("You can find data for heat map in output/heat_map_data.pkl file")
+    print(f"Per-run losses and timings are in {sweep_file}")
 
 
 def draw_heat_map(in_file, out_file, labels_x, labels_y):
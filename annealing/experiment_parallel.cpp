@@ -1,114 +1,160 @@
 #include "src/annealing.h"
-#include <fstream>
+#include "src/parallel.h"
+#include <stdexcept>
 #include <string>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <sys/socket.h>
 
 int main (int argc, char *argv[]) {
-    std::string input_file = argv[1];
+    // --seed N делает запуск воспроизводимым, --moves end=1,swap=0.5,...
+    // задаёт вероятности видов ходов, --init single|spt|lpt|greedy -
+    // начальное расписание, --gap X - остановка при отклонении от оптимума
+    // не больше X, --min-temp T и --max-temp T - концы лестницы температур
+    // в режиме tempering (по умолчанию 1 и 1000), --topology ring|broadcast
+    // и --migrate-every N - схема и частота миграций в режиме islands,
+    // --chains N, --budget N и --race-every N - число цепочек (по умолчанию
+    // 2 на поток), общий бюджет итераций (по умолчанию 10^6 на поток)
+    // и частота отсевов в режиме racing, остальные аргументы позиционные.
+    std::vector<std::string> args;
+    std::uint64_t seed = random_seed();
+    std::string moves;
+    std::string init = "single";
+    std::string topology = "ring";
+    int chains = 0;
+    long long budget = 0;
+    double min_temp = 1;
+    double max_temp = 1000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--moves" && i + 1 < argc) {
+            moves = argv[++i];
+        } else if (arg == "--init" && i + 1 < argc) {
+            init = argv[++i];
+        } else if (arg == "--gap" && i + 1 < argc) {
+            CONFIG::OPTIMALITY_GAP = std::stod(argv[++i]);
+        } else if (arg == "--min-temp" && i + 1 < argc) {
+            min_temp = std::stod(argv[++i]);
+        } else if (arg == "--max-temp" && i + 1 < argc) {
+            max_temp = std::stod(argv[++i]);
+        } else if (arg == "--topology" && i + 1 < argc) {
+            topology = argv[++i];
+        } else if (arg == "--migrate-every" && i + 1 < argc) {
+            CONFIG::MIGRATION_INTERVAL = std::stoi(argv[++i]);
+        } else if (arg == "--chains" && i + 1 < argc) {
+            chains = std::stoi(argv[++i]);
+        } else if (arg == "--budget" && i + 1 < argc) {
+            budget = std::stoll(argv[++i]);
+        } else if (arg == "--race-every" && i + 1 < argc) {
+            CONFIG::RACE_INTERVAL = std::stoi(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        std::cerr << "usage: " << argv[0] << " input [law [PROCS [mode [seconds]]]] [options]\n";
+        exit(1);
+    }
+    std::cerr << "seed: " << seed << '\n';
+
+    std::string input_file = args[0];
 
     std::string law_type = "mixed";
-    if (argc >= 3) {
-        law_type = argv[2];
+    if (args.size() >= 2) {
+        law_type = args[1];
     }
 
     int PROCS = 4;
-    if (argc == 4) {
-        PROCS = std::stoi(std::string(argv[3]));
+    if (args.size() >= 3) {
+        PROCS = std::stoi(args[2]);
     }
-
-    std::ifstream my_file(input_file);
-
-    if (!my_file.is_open()) {
-        std::cerr << "Can't open file\n";
+    if (PROCS < 1) {
+        std::cerr << "PROCS must be positive\n";
         exit(1);
     }
 
-    int k;
-    int task;
-    char buf;
-    my_file >> k;
-    my_file >> buf;
-
-    std::vector<int> tasks;
-
-    while (my_file >> task) {
-        tasks.push_back(task);
-        my_file >> buf;
+    // chains - независимые цепочки с обменом лучшим решением между раундами,
+    // tempering - параллельный отжиг с лестницей температур на seconds секунд,
+    // islands - острова с асинхронной миграцией на seconds секунд,
+    // racing - гонка цепочек с отсевом худших.
+    std::string mode = "chains";
+    if (args.size() >= 4) {
+        mode = args[3];
     }
-
-    //k = 3;
-    //tasks = std::vector({1, 10, 20, 222, 1, 50, 70, 23, 14});
-
-    ImplAnnealingSolution* ann = new ImplAnnealingSolution(k, tasks);
-    ImplAnnealingSolution* best_ann = new ImplAnnealingSolution(*ann);
-    ImplAnnealingSolution* new_ann = new ImplAnnealingSolution(*ann);
-    ImplMutateSolution mut = ImplMutateSolution();
-
-    LowerTemperature* law;
-    if (law_type == "boltzmann") {
-        law = new BoltzmannLaw();
-    } else if (law_type == "cauchy") {
-        law = new CauchyLaw();
-    } else {
-        law = new MixedLaw();
+    double seconds = 10;
+    if (args.size() >= 5) {
+        seconds = std::stod(args[4]);
+    }
+    // 0 у --chains и --budget - значение по умолчанию. Без цепочек гонка
+    // делила бы бюджет на ноль, с нулевым интервалом не продвигалась бы.
+    if (chains < 0 || budget < 0) {
+        std::cerr << "--chains and --budget can't be negative\n";
+        exit(1);
+    }
+    if (!(min_temp > 0 && min_temp <= max_temp)) {
+        std::cerr << "Temperatures must satisfy 0 < --min-temp <= --max-temp\n";
+        exit(1);
+    }
+    if (CONFIG::RACE_INTERVAL < 1) {
+        std::cerr << "--race-every must be positive\n";
+        exit(1);
     }
 
-    int max_iter_without_improvement = 10;
-    int without_improvement = 0;
-    int best_loss = ann->get_loss_metric();
-
-    while (without_improvement < max_iter_without_improvement) {
-        //std::cout << "SEND\n";
-        //ann->print();
-        std::vector<int> sons_sockets{};
-        for (int i = 0; i < PROCS; ++i) {
-            int descs[2];
-            socketpair(AF_UNIX, SOCK_STREAM, 0, descs);
-
-            pid_t pid = fork();
-            if (pid == 0) {
-                close(descs[0]);
-                SimulateAnnealing sim = SimulateAnnealing(ann, best_ann, new_ann, mut, *law, 1000);
-                sim.simulate_annealing();
-                //std::cout << "PROC " << i << ":\n";
-                //sim.print_res();
-                sim.get_solution()->to_bytes(descs[1]);
-
-                sim.clear();
-                delete law;
+    std::shared_ptr<const Instance> instance;
+    try {
+        // Бинарный экземпляр отображается в память, CSV разбирается через from_chars.
+        instance = Instance::load(input_file);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
 
-                close(descs[1]);
-                return 0;
-            } else {
-                close(descs[1]);
-                sons_sockets.push_back(descs[0]);
-            }
+    ImplAnnealingSolution ann = ImplAnnealingSolution(instance);
+    ImplMutateSolution mut = ImplMutateSolution();
+    try {
+        ann = ImplAnnealingSolution::initial(instance, init);
+        if (!moves.empty()) {
+            mut.set_move_weights(ImplMutateSolution::MoveWeights::parse(moves));
         }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
 
-        for (int i = 0; i < PROCS; ++i) {
-            new_ann->from_bytes(sons_sockets[i]);
-            close(sons_sockets[i]);
-            if (int loss; (loss = new_ann->get_loss_metric()) < best_loss) {
-                *ann = *new_ann;
-                *best_ann = *new_ann;
-                best_loss = loss;
-                without_improvement = 0;
-                std::cout << "NEW BEST SOLUTION\n";
-                std::cout << loss << '\n';
-            }
+    auto print_memory = [&](std::size_t chain, int count) {
+        std::cerr << "memory per chain: " << chain / double(1 << 20) << " MiB x " << count
+                  << ", shared instance: " << instance->size() * sizeof(std::int32_t) / double(1 << 20)
+                  << " MiB\n";
+    };
+    // Сводка проб печатается после того, как потоки движка завершились.
+    ProfileReport profile;
+    visit_law(law_type, [&](auto& law) {
+        if (mode == "tempering") {
+            BasicReplicaExchangeAnnealing sim = BasicReplicaExchangeAnnealing(ann, mut, min_temp, max_temp, PROCS, seed);
+            sim.simulate_annealing(seconds);
+            sim.print_loss();
+            print_memory(sim.chain_memory_usage(), PROCS);
+            sim.print_swap_rates();
+        } else if (mode == "islands") {
+            auto scheme = topology == "broadcast" ? MigrationTopology::BROADCAST : MigrationTopology::RING;
+            BasicIslandAnnealing sim = BasicIslandAnnealing(ann, mut, law, 1000, PROCS, scheme, seed);
+            sim.simulate_annealing(seconds);
+            sim.print_loss();
+            print_memory(sim.chain_memory_usage(), PROCS);
+        } else if (mode == "racing") {
+            int racers = chains > 0 ? chains : 2 * PROCS;
+            BasicRacingAnnealing sim = BasicRacingAnnealing(ann, mut, law, 1000, racers, PROCS, seed);
+            sim.simulate_annealing(budget > 0 ? budget : 1000000LL * PROCS);
+            sim.print_loss();
+            print_memory(sim.chain_memory_usage(), racers);
+        } else {
+            // Цепочки работают в потоках одного процесса и обмениваются лучшим
+            // решением через память, без fork и сокетов на каждый раунд.
+            BasicParallelSimulateAnnealing sim = BasicParallelSimulateAnnealing(ann, mut, law, 1000, PROCS, seed);
+            sim.simulate_annealing();
+            sim.print_loss();
+            print_memory(sim.chain_memory_usage(), PROCS);
         }
-        ++without_improvement;
-        int status;
-        while (wait(&status) != -1);
-    }
-    std::cout << ann->get_loss_metric() << '\n';
+    });
 
-    delete ann;
-    delete best_ann;
-    delete new_ann;
-    delete law;
     return 0;
 }
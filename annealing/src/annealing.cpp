@@ -1,158 +1,693 @@
 #include "annealing.h"
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
 #include <unistd.h>
-#include <random>
-#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 namespace CONFIG {
     int MAX_ITER_WITHOUT_IMPROVEMENT = 1000;
     int STEPS_WITHOUT_TEMP_DECREASE = 5;
+    // После стольких принятых ходов без улучшения лучшее решение копируется
+    // в буфер, чтобы журнал отката не рос бесконечно.
+    std::size_t MAX_JOURNAL_SIZE = 100000;
+    // Сколько ходов оценивать одним блоком; 1 - по одному, как раньше.
+    int MOVE_BLOCK_SIZE = 1;
+    // Отжиг останавливается, когда (метрика - нижняя граница) / граница
+    // не больше этого значения. 0 - только по достижении оптимума.
+    double OPTIMALITY_GAP = 0;
+    // Итераций между проверками срока и токена отмены (set_deadline,
+    // set_cancellation).
+    int DEADLINE_CHECK_INTERVAL = 256;
+    // Наименьший промежуток между публикациями лучшего решения в BestSnapshot.
+    int BEST_PUBLISH_MS = 50;
 }
 
+namespace {
+    // FNV-1a по 32-битным словам: кадр проверяется за один проход без побайтового цикла.
+    std::uint64_t wire_checksum(std::uint64_t hash, const void* data, std::size_t words) {
+        const char* bytes = static_cast<const char*>(data);
+        for (std::size_t i = 0; i < words; ++i) {
+            std::uint32_t word;
+            std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+            hash = (hash ^ word) * 0x100000001b3;
+        }
+        return hash;
+    }
 
-void SimulateAnnealing::annealing_step() {
-    for (int i = 0; i < CONFIG::STEPS_WITHOUT_TEMP_DECREASE; ++i) {
-        mutation(solution, new_solution);
-        if (long long loss = 0; (loss = new_solution->get_loss_metric()) <= cur_loss) {
-            replace_solution(loss);
-        } else {
-            long long df = loss - smallest_loss;
-            double p = std::exp(-df / cur_temp);
-            if (dis(gen) < p) {
-                replace_solution(loss);
+    constexpr std::uint64_t CHECKSUM_SEED = 0xcbf29ce484222325;
+
+    // Номера работ, упорядоченные по длительности; при равенстве - по номеру,
+    // чтобы расписание не зависело от реализации сортировки.
+    bool works_less(const Instance& instance, std::int32_t a, std::int32_t b) {
+        return instance[a] != instance[b] ? instance[a] < instance[b] : a < b;
+    }
+
+    void sort_works(const Instance& instance, std::int32_t* order, bool descending) {
+        std::iota(order, order + instance.size(), 0);
+        std::sort(order, order + instance.size(), [&](std::int32_t a, std::int32_t b) {
+            return descending ? works_less(instance, b, a) : works_less(instance, a, b);
+        });
+    }
+
+    // Раздаёт работы в порядке order, каждую на наименее загруженный процессор
+    // (при равной нагрузке - с меньшим номером). Куча процессоров по (нагрузка,
+    // номер), O(n log k). При k > n процессоры с номерами от n работ не получают,
+    // так что heap вмещает min(k, n) номеров, а loads - k нагрузок.
+    void least_loaded(const Instance& instance, const std::int32_t* order, std::int32_t* heap
+                      , long long* loads, QueueArena& schedule) {
+        int size = std::min<std::size_t>(instance.procs(), instance.size());
+        std::iota(heap, heap + size, 0);
+        std::fill(loads, loads + size, 0);
+        auto later = [&](std::int32_t a, std::int32_t b) {
+            return loads[a] != loads[b] ? loads[a] > loads[b] : a > b;
+        };
+        schedule.reset(instance.procs(), instance.size());
+        for (std::int32_t work : std::span(order, instance.size())) {
+            std::pop_heap(heap, heap + size, later);
+            std::int32_t proc = heap[size - 1];
+            schedule.push_back(proc, work);
+            loads[proc] += instance[work];
+            std::push_heap(heap, heap + size, later);
+        }
+    }
+
+    bool read_all(int fd, char* buf, std::size_t size) {
+        while (size > 0) {
+            ssize_t got = read(fd, buf, size);
+            if (got == -1 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return false;
             }
+            buf += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    bool write_all(int fd, const char* buf, std::size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd, buf, size);
+            if (written == -1 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            buf += written;
+            size -= written;
+        }
+        return true;
+    }
+}
+
+
+void ImplAnnealingSolution::recompute() {
+    loads.assign(k, 0);
+    positions.assign(instance->size(), 0);
+    finish.assign(instance->size(), 0);
+    loss = 0;
+    for (int i = 0; i < k; ++i) {
+        const std::int32_t* queue = schedule.data(i);
+        long long start = 0;
+        for (std::int32_t j = 0; j < schedule.size(i); ++j) {
+            std::int32_t work = queue[j];
+            start += works[work];
+            positions[work] = j;
+            finish[work] = start;
+            works_binding[work] = i;
+            loss += start;
         }
+        loads[i] = start;
     }
 }
 
-void SimulateAnnealing::replace_solution(long long loss) {
-    if (loss < smallest_loss) {
-        iter_with_improvement = iter;
-        smallest_loss = loss;
-        *best_solution = *new_solution;
-        //std::cout << "New loss " << smallest_loss << '\n';
+void ImplAnnealingSolution::refresh(int proc, int from) {
+    const std::int32_t* queue = schedule.data(proc);
+    long long start = from > 0 ? finish[queue[from - 1]] : 0;
+    for (std::int32_t j = from; j < schedule.size(proc); ++j) {
+        std::int32_t work = queue[j];
+        start += works[work];
+        positions[work] = j;
+        finish[work] = start;
     }
-    cur_loss = loss;
-    AnnealingSolution* temp = solution;
-  solution = new_solution;
-    new_solution = temp;
 }
 
-void SimulateAnnealing::simulate_annealing() {
-    gen.seed(rd());
-    while (1) {
-        ++iter;
-        annealing_step();
-        if (iter - iter_with_improvement > CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT) {
-            break;
+void ImplAnnealingSolution::move_deltas(const std::uint32_t* work, const std::uint32_t* proc
+                                        , long long* deltas, int count) const {
+    int i = 0;
+#ifdef __AVX2__
+    // Те же формулы, что в move_delta: индексы и длительности собираются
+    // gather-инструкциями по восемь, 64-битные суммы считаются по четыре.
+    const int* binding = works_binding.data();
+    const int* pos = positions.data();
+    const int* duration = works;
+    const int* length = schedule.sizes();
+    const long long* end = finish.data();
+    const long long* load = loads.data();
+    __m256i one = _mm256_set1_epi32(1);
+    for (; i + 8 <= count; i += 8) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + i));
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(proc + i));
+        __m256i old = _mm256_i32gather_epi32(binding, w, 4);
+        __m256i d = _mm256_i32gather_epi32(duration, w, 4);
+        __m256i tail = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_i32gather_epi32(length, old, 4)
+                                                         , _mm256_i32gather_epi32(pos, w, 4)), one);
+        // При переносе в свою же очередь новая нагрузка не растёт на d.
+        __m256i moved = _mm256_andnot_si256(_mm256_cmpeq_epi32(p, old), d);
+        for (int half = 0; half < 2; ++half) {
+            __m128i w_h = half ? _mm256_extracti128_si256(w, 1) : _mm256_castsi256_si128(w);
+            __m128i p_h = half ? _mm256_extracti128_si256(p, 1) : _mm256_castsi256_si128(p);
+            __m128i d_h = half ? _mm256_extracti128_si256(d, 1) : _mm256_castsi256_si128(d);
+            __m128i tail_h = half ? _mm256_extracti128_si256(tail, 1) : _mm256_castsi256_si128(tail);
+            __m128i moved_h = half ? _mm256_extracti128_si256(moved, 1) : _mm256_castsi256_si128(moved);
+            __m256i removed = _mm256_i32gather_epi64(end, w_h, 8);
+            __m256i new_load = _mm256_i32gather_epi64(load, p_h, 8);
+            __m256i shift = _mm256_mul_epi32(_mm256_cvtepi32_epi64(d_h)
+                                             , _mm256_cvtepi32_epi64(tail_h));
+            __m256i delta = _mm256_sub_epi64(_mm256_add_epi64(_mm256_sub_epi64(new_load, removed)
+                                                              , _mm256_cvtepi32_epi64(moved_h))
+                                             , shift);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(deltas + i + 4 * half), delta);
         }
-        cur_temp = temperature_decrease_law(start_temp, iter);
+    }
+#endif
+    for (; i < count; ++i) {
+        deltas[i] = move_delta({int(work[i]), int(proc[i])});
     }
 }
 
-long long ImplAnnealingSolution::get_loss_metric() const {
-    long long metric = 0;
-    long long start = 0;
-    for (const std::vector<int>& v : schedule) {
-        start = 0;
-        for (int work : v) {
-            metric += start + works[work];
-            start += works[work];
+void ImplAnnealingSolution::reset(std::shared_ptr<const Instance> next) {
+    instance = std::move(next);
+    works = instance->durations();
+    k = instance->procs();
+    schedule.reset(k, instance->size());
+    std::int32_t* queue = schedule.extend(0, instance->size());
+    std::iota(queue, queue + instance->size(), 0);
+    works_binding.assign(instance->size(), 0);
+    recompute();
+}
+
+// Порядок работ строится в positions, куча процессоров - в works_binding:
+// оба массива длины n, и recompute в конце всё равно их перезаписывает.
+void ImplAnnealingSolution::arrange_spt() {
+    std::int32_t* order = positions.data();
+    sort_works(*instance, order, false);
+    schedule.reset(k, instance->size());
+    for (std::size_t i = 0; i < instance->size(); ++i) {
+        schedule.push_back(i % k, order[i]);
+    }
+    recompute();
+}
+
+void ImplAnnealingSolution::arrange_lpt() {
+    sort_works(*instance, positions.data(), true);
+    least_loaded(*instance, positions.data(), works_binding.data(), loads.data(), schedule);
+    // Для суммы моментов завершения короткие работы выгоднее ставить первыми.
+    for (int i = 0; i < k; ++i) {
+        std::reverse(schedule.data(i), schedule.data(i) + schedule.size(i));
+    }
+    recompute();
+}
+
+void ImplAnnealingSolution::arrange_greedy() {
+    std::iota(positions.begin(), positions.end(), 0);
+    least_loaded(*instance, positions.data(), works_binding.data(), loads.data(), schedule);
+    for (int i = 0; i < k; ++i) {
+        std::sort(schedule.data(i), schedule.data(i) + schedule.size(i), [&](std::int32_t a, std::int32_t b) {
+            return works_less(*instance, a, b);
+        });
+    }
+    recompute();
+}
+
+void ImplAnnealingSolution::arrange(const std::string& method) {
+    if (method == "spt") {
+        arrange_spt();
+    } else if (method == "lpt") {
+        arrange_lpt();
+    } else if (method == "greedy") {
+        arrange_greedy();
+    } else if (method != "single") {
+        throw std::runtime_error("Unknown initial schedule " + method);
+    }
+}
+
+ImplAnnealingSolution ImplAnnealingSolution::spt_round_robin(std::shared_ptr<const Instance> instance) {
+    ImplAnnealingSolution solution(instance);
+    solution.arrange_spt();
+    return solution;
+}
+
+ImplAnnealingSolution ImplAnnealingSolution::lpt(std::shared_ptr<const Instance> instance) {
+    ImplAnnealingSolution solution(instance);
+    solution.arrange_lpt();
+    return solution;
+}
+
+ImplAnnealingSolution ImplAnnealingSolution::greedy(std::shared_ptr<const Instance> instance) {
+    ImplAnnealingSolution solution(instance);
+    solution.arrange_greedy();
+    return solution;
+}
+
+ImplAnnealingSolution ImplAnnealingSolution::initial(std::shared_ptr<const Instance> instance
+                                                     , const std::string& method) {
+    ImplAnnealingSolution solution(instance);
+    solution.arrange(method);
+    return solution;
+}
+
+void ImplAnnealingSolution::reset(std::shared_ptr<const Instance> next, const std::string& method) {
+    reset(std::move(next));
+    arrange(method);
+}
+
+void ImplAnnealingSolution::erase_at(int proc, int position) {
+    int work = schedule.data(proc)[position];
+    schedule.erase(proc, position);
+    refresh(proc, position);
+    loads[proc] -= works[work];
+}
+
+void ImplAnnealingSolution::insert_at(int proc, int position, int work) {
+    schedule.insert(proc, position, work);
+    refresh(proc, position);
+    works_binding[work] = proc;
+    loads[proc] += works[work];
+}
+
+void ImplAnnealingSolution::swap_works(int work, int other) {
+    int a = works_binding[work];
+    int b = works_binding[other];
+    int p = positions[work];
+    int q = positions[other];
+    schedule.data(a)[p] = other;
+    schedule.data(b)[q] = work;
+    works_binding[work] = b;
+    works_binding[other] = a;
+    if (a == b) {
+        refresh(a, std::min(p, q));
+        return;
+    }
+    refresh(a, p);
+    refresh(b, q);
+    long long diff = works[other] - works[work];
+    loads[a] += diff;
+    loads[b] -= diff;
+}
+
+// Снятие work с позиции p очереди a с сохранением порядка: сама работа
+// завершалась в момент finish, и каждая из m_a - p - 1 следующих
+// работ завершится на d раньше, итого finish + d (m_a - p - 1).
+// Вставка на позицию j очереди длины m без work: prefix(j) + d (m - j + 1).
+long long ImplAnnealingSolution::best_relocation(int work, int proc, int& position) const {
+    int old_proc = works_binding[work];
+    long long duration = works[work];
+    long long removed = finish[work] + duration * (schedule.size(old_proc) - positions[work] - 1);
+
+    int m = schedule.size(proc) - (proc == old_proc);
+    long long best = duration * (m + 1);
+    position = 0;
+    long long prefix = 0;
+    int j = 0;
+    const std::int32_t* queue = schedule.data(proc);
+    for (std::int32_t other : std::span(queue, schedule.size(proc))) {
+        if (other == work) {
+            continue;
+        }
+        prefix += works[other];
+        ++j;
+        long long cost = prefix + duration * (m - j + 1);
+        if (cost < best) {
+            best = cost;
+            position = j;
+        }
+    }
+    return best - removed;
+}
+
+long long ImplAnnealingSolution::relocation_delta(int work, int proc, int position) const {
+    int old_proc = works_binding[work];
+    long long duration = works[work];
+    long long removed = finish[work] + duration * (schedule.size(old_proc) - positions[work] - 1);
+
+    // prefix(j) - момент завершения работы j - 1 очереди без work.
+    int m = schedule.size(proc) - (proc == old_proc);
+    long long prefix = 0;
+    if (position > 0) {
+        const std::int32_t* queue = schedule.data(proc);
+        if (proc == old_proc && position > positions[work]) {
+            prefix = finish[queue[position]] - duration;
+        } else {
+            prefix = finish[queue[position - 1]];
         }
     }
-    return metric;
+    return prefix + duration * (m - position + 1) - removed;
+}
+
+void ImplAnnealingSolution::undo_move(const UndoRecord& undo) {
+    if (undo.type == SWAP || undo.type == EXCHANGE) {
+        swap_works(undo.work, undo.other);
+        loss -= undo.delta;
+        return;
+    }
+    erase_at(works_binding[undo.work], positions[undo.work]);
+    insert_at(undo.proc, undo.position, undo.work);
+    loss -= undo.delta;
 }
 
 AnnealingSolution& ImplAnnealingSolution::operator=(const AnnealingSolution& other) {
     // Похоже, что без этой перегрузки оператора работать не будет.
     const ImplAnnealingSolution& temp = dynamic_cast<const ImplAnnealingSolution&>(other);
-    k = temp.k;
+    instance = temp.instance;
     works = temp.works;
+    k = temp.k;
     schedule = temp.schedule;
     works_binding = temp.works_binding;
+    loads = temp.loads;
+    positions = temp.positions;
+    finish = temp.finish;
+    loss = temp.loss;
     return *this;
 }
 
 ImplAnnealingSolution& ImplAnnealingSolution::operator=(const ImplAnnealingSolution& other) {
-    k = other.k;
+    instance = other.instance;
     works = other.works;
+    k = other.k;
     schedule = other.schedule;
     works_binding = other.works_binding;
+    loads = other.loads;
+    positions = other.positions;
+    finish = other.finish;
+    loss = other.loss;
     return *this;
 }
     
 
 void ImplAnnealingSolution::print() const {
-    for (int i = 0; i < schedule.size(); ++i) {
+    for (int i = 0; i < k; ++i) {
+        const std::int32_t* queue = schedule.data(i);
         std::cout << i << ": ";
-        for (int j = 0; j < schedule[i].size(); ++j) {
-            std::cout << schedule[i][j]  << ':' << works[schedule[i][j]] << ' ';
+        for (std::int32_t j = 0; j < schedule.size(i); ++j) {
+            std::cout << queue[j]  << ':' << works[queue[j]] << ' ';
         }
         std::cout << '\n';
     }
 }
 
-void ImplAnnealingSolution::to_bytes(int fd) const {
-    for (int i = 0; i < schedule.size(); ++i) {
-        size_t proc_queue_size = schedule[i].size();
-        write(fd, &proc_queue_size, sizeof(proc_queue_size));
-        for (const int& task : schedule[i]) {
-            write(fd, &task, sizeof(task));
-        }
-    }
+std::size_t ImplAnnealingSolution::memory_usage() const {
+    return schedule.memory_usage()
+           + (works_binding.capacity() + positions.capacity()) * sizeof(std::int32_t)
+           + (finish.capacity() + loads.capacity()) * sizeof(long long);
 }
 
-void ImplAnnealingSolution::from_bytes(int fd) {
+void ImplAnnealingSolution::serialize(char* out) const {
+    WireHeader header{WIRE_MAGIC, std::uint32_t(k), instance->size(), CHECKSUM_SEED};
+    char* lengths = out + sizeof(header);
+    char* payload = lengths + k * sizeof(std::uint32_t);
+    for (int i = 0; i < k; ++i) {
+        std::uint32_t length = schedule.size(i);
+        std::memcpy(lengths + i * sizeof(length), &length, sizeof(length));
+    }
+    header.checksum = wire_checksum(header.checksum, lengths, k);
     for (int i = 0; i < k; ++i) {
-        size_t proc_queue_size;
-        read(fd, &proc_queue_size, sizeof(proc_queue_size));
-        schedule[i] = std::vector<int>();
-        for (int j = 0; j < proc_queue_size; ++j) {
-            int task;
-            read(fd, &task, sizeof(task));
-            schedule[i].push_back(task);
-            works_binding[task] = i;
+        if (schedule.empty(i)) {
+            continue;
         }
+        std::memcpy(payload, schedule.data(i), schedule.size(i) * sizeof(std::int32_t));
+        header.checksum = wire_checksum(header.checksum, payload, schedule.size(i));
+        payload += schedule.size(i) * sizeof(std::int32_t);
     }
+    std::memcpy(out, &header, sizeof(header));
 }
 
+void ImplAnnealingSolution::to_bytes(int fd) const {
+    std::vector<char> frame(serialized_size());
+    serialize(frame.data());
+    if (!write_all(fd, frame.data(), frame.size())) {
+        throw std::runtime_error("Can't write solution frame");
+    }
+}
 
-double BoltzmannLaw::operator()(double temp, int iter) const {
-    return temp / std::log(1+iter);
+void ImplAnnealingSolution::decode(const WireHeader& header, const char* body) {
+    std::size_t n = instance->size();
+    if (header.magic != WIRE_MAGIC || header.k != std::uint32_t(k) || header.n != n) {
+        throw std::runtime_error("Solution frame doesn't match the instance");
+    }
+    const char* payload = body + k * sizeof(std::uint32_t);
+    if (wire_checksum(CHECKSUM_SEED, body, k + n) != header.checksum) {
+        throw std::runtime_error("Solution frame checksum mismatch");
+    }
+
+    std::size_t total = 0;
+    for (int i = 0; i < k; ++i) {
+        std::uint32_t length;
+        std::memcpy(&length, body + i * sizeof(length), sizeof(length));
+        total += length;
+    }
+    if (total != n) {
+        throw std::runtime_error("Solution frame has wrong queue lengths");
+    }
+    // Каждая работа должна встретиться ровно один раз.
+    std::vector<char> seen(n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::int32_t task;
+        std::memcpy(&task, payload + i * sizeof(task), sizeof(task));
+        if (task < 0 || std::size_t(task) >= n || seen[task]) {
+            throw std::runtime_error("Solution frame is not a schedule");
+        }
+        seen[task] = 1;
+    }
+
+    schedule.reset(k, n);
+    for (int i = 0; i < k; ++i) {
+        std::uint32_t length;
+        std::memcpy(&length, body + i * sizeof(length), sizeof(length));
+        if (length != 0) {
+            std::memcpy(schedule.extend(i, length), payload, length * sizeof(std::int32_t));
+        }
+        payload += length * sizeof(std::int32_t);
+    }
+    recompute();
 }
 
-double CauchyLaw::operator()(double temp, int iter) const {
-    return temp / (1 + iter);
+void ImplAnnealingSolution::deserialize(const char* frame, std::size_t size) {
+    WireHeader header;
+    if (size != serialized_size()) {
+        throw std::runtime_error("Solution frame has wrong size");
+    }
+    std::memcpy(&header, frame, sizeof(header));
+    decode(header, frame + sizeof(header));
 }
 
-double MixedLaw::operator()(double temp, int iter) const {
-    return temp * std::log(1 + iter) / (1 + iter);
+void ImplAnnealingSolution::from_bytes(int fd) {
+    WireHeader header;
+    if (!read_all(fd, reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw std::runtime_error("Short read of solution frame header");
+    }
+    if (header.magic != WIRE_MAGIC || header.k != std::uint32_t(k) || header.n != instance->size()) {
+        throw std::runtime_error("Solution frame doesn't match the instance");
+    }
+    std::vector<char> body((k + instance->size()) * sizeof(std::int32_t));
+    if (!read_all(fd, body.data(), body.size())) {
+        throw std::runtime_error("Short read of solution frame");
+    }
+    decode(header, body.data());
 }
 
+
 ImplAnnealingSolution* ImplMutateSolution::operator()(AnnealingSolution* solution,
                                                       AnnealingSolution* new_solution) {
-    *new_solution = *solution;
-    // dynamic_cast'ы хоть и не способствуют разделению абстракций и реализации,
-    // но можно добавить чисто виртуальные методы в AnnealingSolution для изменения
-    // решения и оперировать только ими.
+    // Старый протокол с копированием решения, основной цикл использует propose/apply.
+    if (new_solution != solution) {
+        *new_solution = *solution;
+    }
     ImplAnnealingSolution* i_new_solution = dynamic_cast<ImplAnnealingSolution*>(new_solution);
-    ImplAnnealingSolution* i_solution = dynamic_cast<ImplAnnealingSolution*>(solution);
+    propose(i_new_solution);
+    i_new_solution->apply_move(move, proposed_delta);
+    return i_new_solution;
+}
 
-    int n = i_new_solution->works.size();
-    int k = i_new_solution->k;
+ImplMutateSolution::MoveWeights ImplMutateSolution::MoveWeights::parse(const std::string& spec) {
+    MoveWeights result;
+    result.to_end = 0;
+    std::stringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error("Bad move weight " + item);
+        }
+        std::string name = item.substr(0, eq);
+        double value;
+        try {
+            value = std::stod(item.substr(eq + 1));
+        } catch (const std::exception&) {
+            throw std::runtime_error("Bad move weight " + item);
+        }
+        if (name == "end") {
+            result.to_end = value;
+        } else if (name == "swap") {
+            result.swap = value;
+        } else if (name == "exchange") {
+            result.exchange = value;
+        } else if (name == "relocate") {
+            result.relocate = value;
+        } else {
+            throw std::runtime_error("Unknown move type " + name);
+        }
+    }
+    return result;
+}
 
-    gen.seed(rd());
-    std::uniform_int_distribution<> dis_works(0, n-1);
-    std::uniform_int_distribution<> dis_procs(0, k-1);
-    
-    int work_num = dis_works(gen);
-    int proc_num = dis_procs(gen);
-
-    int old_proc = i_new_solution->works_binding[work_num];
-    i_new_solution->works_binding[work_num] = proc_num;
-    std::vector<int>& old_proc_jobs = i_new_solution->schedule[old_proc];
-    old_proc_jobs.erase(std::find(old_proc_jobs.begin(),
-                                  old_proc_jobs.end(),
-                                  work_num));
-    i_new_solution->schedule[proc_num].push_back(work_num);
-    return i_new_solution;
+void ImplMutateSolution::set_move_weights(const MoveWeights& new_weights) {
+    double values[] = {new_weights.to_end, new_weights.swap
+                       , new_weights.exchange, new_weights.relocate};
+    double total = 0;
+    for (double value : values) {
+        if (!(value >= 0)) {
+            throw std::runtime_error("Move weights must be non-negative");
+        }
+        total += value;
+    }
+    if (total <= 0) {
+        throw std::runtime_error("At least one move weight must be positive");
+    }
+    weights = new_weights;
+    double cumulative = 0;
+    for (int i = 0; i < ImplAnnealingSolution::MOVE_TYPES; ++i) {
+        cumulative += values[i];
+        thresholds[i] = cumulative / total * TYPE_SCALE;
+    }
+    thresholds[ImplAnnealingSolution::MOVE_TYPES - 1] = TYPE_SCALE;
+    mixed = values[0] != total;
+    types_block.reset();
+}
+
+ImplMutateSolution* ImplMutateSolution::clone() const {
+    ImplMutateSolution* copy = new ImplMutateSolution();
+    copy->set_move_weights(weights);
+    return copy;
+}
+
+// Генератор, заготовленные блоки и последний блок ходов лежат подряд.
+std::size_t ImplMutateSolution::state_size() const {
+    return sizeof(gen) + sizeof(works_block) + sizeof(procs_block) + sizeof(types_block)
+           + sizeof(works_bound) + sizeof(procs_bound) + sizeof(block_works) + sizeof(block_procs);
+}
+
+void ImplMutateSolution::save_state(char* out) const {
+    auto put = [&](const auto& value) {
+        std::memcpy(out, &value, sizeof(value));
+        out += sizeof(value);
+    };
+    put(gen);
+    put(works_block);
+    put(procs_block);
+    put(types_block);
+    put(works_bound);
+    put(procs_bound);
+    put(block_works);
+    put(block_procs);
+}
+
+void ImplMutateSolution::load_state(const char* in) {
+    auto get = [&](auto& value) {
+        std::memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+    };
+    get(gen);
+    get(works_block);
+    get(procs_block);
+    get(types_block);
+    get(works_bound);
+    get(procs_bound);
+    get(block_works);
+    get(block_procs);
+}
+
+long long ImplMutateSolution::propose_mixed(const ImplAnnealingSolution* solution) {
+    std::uint32_t r = types_block.next([&](std::uint32_t* out, int count) {
+        gen.fill_below(out, count, TYPE_SCALE);
+    });
+    int type = 0;
+    while (r >= thresholds[type]) {
+        ++type;
+    }
+    move = random_move(solution);
+    move.type = ImplAnnealingSolution::MoveType(type);
+
+    switch (move.type) {
+    case ImplAnnealingSolution::SWAP:
+        move.other = works_block.next([&](std::uint32_t* out, int count) {
+            gen.fill_below(out, count, works_bound);
+        });
+        break;
+    case ImplAnnealingSolution::EXCHANGE: {
+        // Сосед справа, у последней работы - сосед слева.
+        int proc = solution->works_binding[move.work];
+        int position = solution->positions[move.work];
+        const std::int32_t* queue = solution->schedule.data(proc);
+        if (position + 1 < solution->schedule.size(proc)) {
+            move.other = queue[position + 1];
+        } else if (position > 0) {
+            move.other = queue[position - 1];
+        } else {
+            move.other = move.work;
+        }
+        break;
+    }
+    case ImplAnnealingSolution::RELOCATE:
+        return proposed_delta = solution->best_relocation(move.work, move.proc, move.other);
+    default:
+        break;
+    }
+    return proposed_delta = solution->move_delta(move);
+}
+
+// Виртуальные версии - адаптер для абстрактного SimulateAnnealing,
+// приводят типы и вызывают типизированные версии.
+long long ImplMutateSolution::propose(const AnnealingSolution* solution) {
+    return propose(dynamic_cast<const ImplAnnealingSolution*>(solution));
+}
+
+void ImplMutateSolution::apply(AnnealingSolution* solution) {
+    apply(dynamic_cast<ImplAnnealingSolution*>(solution));
+}
+
+int ImplMutateSolution::propose_block(const AnnealingSolution* solution, long long* deltas, int count) {
+    return propose_block(dynamic_cast<const ImplAnnealingSolution*>(solution), deltas, count);
+}
+
+void ImplMutateSolution::apply_proposed(AnnealingSolution* solution, int index) {
+    apply_proposed(dynamic_cast<ImplAnnealingSolution*>(solution), index);
+}
+
+int ImplMutateSolution::draw_block(const AnnealingSolution* solution, int count) {
+    return draw_block(dynamic_cast<const ImplAnnealingSolution*>(solution), count);
+}
+
+void ImplMutateSolution::evaluate_block(const AnnealingSolution* solution, long long* deltas
+                                        , int from, int to) const {
+    evaluate_block(dynamic_cast<const ImplAnnealingSolution*>(solution), deltas, from, to);
+}
+
+void ImplMutateSolution::rollback(AnnealingSolution* solution) {
+    rollback(dynamic_cast<ImplAnnealingSolution*>(solution));
+}
+
+void ImplMutateSolution::rollback(ImplAnnealingSolution* solution) {
+    for (auto it = journal.rbegin(); it != journal.rend(); ++it) {
+        solution->undo_move(*it);
+    }
+    journal.clear();
 }
@@ -1,30 +1,139 @@
 #ifndef SRC_ANNEALING_H_
 #define SRC_ANNEALING_H_
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <numeric>
+#include <stdexcept>
 #include <vector>
-#include <map>
-#include <random>
 #include <string>
+#include <type_traits>
+#include "anytime.h"
+#include "checkpoint.h"
+#include "instance.h"
+#include "profile.h"
+#include "queues.h"
+#include "random.h"
+#include "speculation.h"
+#include "telemetry.h"
+
+namespace CONFIG {
+    extern int MAX_ITER_WITHOUT_IMPROVEMENT;
+    extern int STEPS_WITHOUT_TEMP_DECREASE;
+    extern std::size_t MAX_JOURNAL_SIZE;
+    extern int MOVE_BLOCK_SIZE;
+    extern double OPTIMALITY_GAP;
+    extern int DEADLINE_CHECK_INTERVAL;
+    extern int BEST_PUBLISH_MS;
+}
 
 class AnnealingSolution {
 public:
     virtual long long get_loss_metric() const = 0;
+    // Нижняя граница метрики, 0 - если неизвестна.
+    virtual long long get_loss_lower_bound() const {return 0;}
     virtual void print() const = 0;
+    // to_bytes отправляет решение одним кадром, from_bytes читает кадр целиком,
+    // проверяет его длину и контрольную сумму и при ошибке бросает std::runtime_error.
     virtual void to_bytes(int) const = 0;
     virtual void from_bytes(int) = 0;
+    // Тот же кадр в памяти: serialize пишет serialized_size() байт.
+    virtual std::size_t serialized_size() const = 0;
+    virtual void serialize(char*) const = 0;
+    virtual void deserialize(const char*, std::size_t) = 0;
 
+    AnnealingSolution() = default;
+    AnnealingSolution(const AnnealingSolution&) = default;
     virtual AnnealingSolution& operator=(const AnnealingSolution& other) = 0;
-
+    // Новая копия решения, нужна параллельным движкам для буферов цепочек.
+    virtual AnnealingSolution* clone() const = 0;
+    // Байт кучи, принадлежащих решению; общие с другими решениями данные
+    // (экземпляр задачи) не считаются. 0 - неизвестно.
+    virtual std::size_t memory_usage() const {return 0;}
 
     virtual ~AnnealingSolution() = default;
 };
 
+// Относительное отклонение loss от нижней границы; NaN, если граница неизвестна.
+inline double optimality_gap(long long loss, long long lower_bound) {
+    if (lower_bound <= 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return double(loss - lower_bound) / lower_bound;
+}
+
+// Отклонение не больше CONFIG::OPTIMALITY_GAP: искать дальше незачем.
+inline bool optimality_gap_reached(long long loss, long long lower_bound) {
+    return lower_bound > 0 && loss - lower_bound <= CONFIG::OPTIMALITY_GAP * lower_bound;
+}
+
 class MutateSolution {
 public:
     virtual AnnealingSolution* operator()(AnnealingSolution*, AnnealingSolution*) = 0;
 
+    // Инкрементальный протокол: propose выбирает случайный ход и возвращает
+    // изменение метрики, не трогая решение, apply применяет последний
+    // предложенный ход. Отвергнутый ход тогда не требует копирования решения.
+    virtual long long propose(const AnnealingSolution*) = 0;
+    virtual void apply(AnnealingSolution*) = 0;
+
+    // Блочный вариант: propose_block предлагает до count ходов против одного
+    // и того же решения, пишет их изменения метрики в deltas и возвращает
+    // число ходов; apply_proposed применяет ход с номером index из блока.
+    // После apply_proposed остальные ходы блока устарели. По умолчанию блок
+    // состоит из одного обычного propose.
+    static constexpr int MAX_BLOCK = 1024;
+    virtual int propose_block(const AnnealingSolution* solution, long long* deltas, int /*count*/) {
+        deltas[0] = propose(solution);
+        return 1;
+    }
+    virtual void apply_proposed(AnnealingSolution* solution, int /*index*/) {
+        apply(solution);
+    }
+    // Тот же блок в две фазы для спекулятивного режима движка: draw_block
+    // разыгрывает ходы и возвращает их число, evaluate_block пишет в deltas
+    // изменения метрики ходов [from, to). Непересекающиеся отрезки можно
+    // оценивать из разных потоков. draw_block и evaluate_block всего блока
+    // равносильны propose_block, так что ходы от способа оценки не зависят.
+    // По умолчанию не поддерживается (std::runtime_error).
+    virtual int draw_block(const AnnealingSolution*, int /*count*/) {
+        throw std::runtime_error("Mutation doesn't support speculative evaluation");
+    }
+    virtual void evaluate_block(const AnnealingSolution*, long long* /*deltas*/, int /*from*/, int /*to*/) const {
+        throw std::runtime_error("Mutation doesn't support speculative evaluation");
+    }
+
+    // Журнал отката: apply запоминает, как отменить применённый ход,
+    // rollback отменяет в решении все ходы журнала в обратном порядке.
+    // Решение, к которому применяется rollback, должно совпадать с тем,
+    // к которому применялись ходы.
+    virtual size_t journal_size() const = 0;
+    virtual void clear_journal() = 0;
+    virtual void rollback(AnnealingSolution*) = 0;
+
+    // Новый объект мутации того же типа с собственным генератором и пустым журналом.
+    virtual MutateSolution* clone() const = 0;
+    // Переводит генератор на поток stream последовательности с зерном seed.
+    virtual void seed(std::uint64_t seed, std::uint64_t stream) = 0;
+
+    // Состояние генератора для контрольных точек: save_state пишет
+    // state_size() байт, load_state читает их обратно. Журнал не сохраняется,
+    // движок перед записью точки материализует лучшее решение.
+    virtual std::size_t state_size() const {return 0;}
+    virtual void save_state(char*) const {}
+    virtual void load_state(const char*) {}
+
+    // Байт кучи, принадлежащих объекту мутации (в основном журнал отката,
+    // до CONFIG::MAX_JOURNAL_SIZE записей). 0 - неизвестно.
+    virtual std::size_t memory_usage() const {return 0;}
+
     virtual ~MutateSolution() = default;
 };
 
@@ -32,136 +141,1060 @@ class LowerTemperature {
 public:
     virtual double operator()(double, int) const = 0;
 
+    // Обратная связь для адаптивных законов. Методы константные: состояние
+    // (текущую температуру, долю принятых ходов) хранит движок, так что один
+    // закон можно разделять между потоками. Фиксированные законы зависят
+    // только от номера итерации.
+    //
+    // Сколько ходов движок должен оценить перед стартом, чтобы подобрать
+    // начальную температуру; 0 - не подбирать.
+    virtual int calibration_samples() const {return 0;}
+    // Начальная температура по средней величине ухудшающего хода.
+    virtual double initial_temperature(double /*mean_uphill*/, double start_temp) const {
+        return start_temp;
+    }
+    // Температура на следующей итерации. acceptance - сглаженная доля принятых
+    // ходов, since_improvement - итераций с последнего улучшения.
+    virtual double next(double start_temp, int iter, double /*cur_temp*/
+                        , double /*acceptance*/, long long /*since_improvement*/) const {
+        return (*this)(start_temp, iter);
+    }
+
     virtual ~LowerTemperature() = default;
 };
 
-class SimulateAnnealing {
-    AnnealingSolution* solution;
-    AnnealingSolution* best_solution;
-    AnnealingSolution* new_solution;
-    MutateSolution& mutation;
-    LowerTemperature& temperature_decrease_law;
+// Движок отжига параметризован типами решения, мутации и закона понижения
+// температуры. С конкретными final-классами компилятор убирает виртуальные
+// вызовы и встраивает мутацию, подсчёт изменения метрики и закон в основной
+// цикл. SimulateAnnealing с абстрактными интерфейсами остаётся адаптером для
+// произвольных реализаций.
+template <class Solution = AnnealingSolution
+          , class Mutation = MutateSolution
+          , class Law = LowerTemperature>
+class BasicSimulateAnnealing {
+    Solution* solution;
+    Solution* best_solution;
+    Mutation& mutation;
+    Law& temperature_decrease_law;
 
     double start_temp;
     double cur_temp;
     long long cur_loss;
     long long smallest_loss;
+    long long lower_bound;
     long long iter_with_improvement = 0;
     long long iter = 0;
+    // Экспоненциально сглаженная доля принятых ходов за итерацию.
+    double acceptance = 1;
+    // Лучшее решение хранится лениво: пока best_synced == false, оно равно
+    // текущему решению с откаченным журналом мутации.
+    bool best_synced = false;
 
-    void annealing_step();
+    int annealing_step();
+    int annealing_block_step();
     void replace_solution(long long);
+    void sync_best();
+    void calibrate();
+
+    Xoshiro256 gen = Xoshiro256(random_seed());
+    RandomBlock<double> uniforms;
+    AnnealingTelemetry telemetry;
+
+    // Блочный режим (CONFIG::MOVE_BLOCK_SIZE > 1): оценённые, но ещё не
+    // проверенные ходы.
+    long long block_deltas[MutateSolution::MAX_BLOCK];
+    int block_size = 0;
+    int block_pos = 0;
+
+    // Контрольная точка: этот заголовок, состояние мутации, текущее и лучшее
+    // решения кадрами serialize, каждая часть с границы 8 байт.
+    struct Checkpoint {
+        double start_temp;
+        double cur_temp;
+        double acceptance;
+        long long cur_loss;
+        long long smallest_loss;
+        long long iter_with_improvement;
+        long long iter;
+        Xoshiro256 gen;
+        RandomBlock<double> uniforms;
+        long long block_deltas[MutateSolution::MAX_BLOCK];
+        int block_size;
+        int block_pos;
+        std::uint64_t mutation_size;
+        std::uint64_t solution_size;
+    };
+    static_assert(std::is_trivially_copyable_v<Checkpoint>);
 
-    std::random_device rd;
-    std::mt19937 gen = std::mt19937(rd());
-    std::uniform_real_distribution<> dis = std::uniform_real_distribution(0.0, 1.0);
+    SnapshotFile* snapshot = nullptr;
+    long long checkpoint_interval = 0;
+
+    // Спекулятивный режим (set_speculation): ходы блока разыгрывает
+    // основная мутация (draw_block), а изменения метрики считают потоки
+    // команды, каждый свой отрезок блока (evaluate_block). Блоки короче
+    // SPECULATION_MIN_BLOCK ходов оцениваются в одном потоке: раунд команды
+    // дороже их оценки.
+    static constexpr int SPECULATION_MIN_BLOCK = 128;
+    std::unique_ptr<SpinTeam> team;
+    std::function<void(int)> speculate;
+
+    // Ограничения прогона проверяются раз в CONFIG::DEADLINE_CHECK_INTERVAL
+    // итераций: итерация - всего несколько ходов, и часы на каждой заметны.
+    // Публикация лучшего решения стоит O(n), поэтому она ещё и не чаще раза
+    // в CONFIG::BEST_PUBLISH_MS миллисекунд.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const CancellationToken* cancellation = nullptr;
+    BestSnapshot* best_snapshot = nullptr;
+    long long published_loss = std::numeric_limits<long long>::max();
+    std::chrono::steady_clock::time_point next_publish;
+    bool limited = false;
+
+    bool limits_reached();
+    void publish_best();
+
+    static std::size_t align8(std::size_t size) {return (size + 7) / 8 * 8;}
+
+public:
+    enum StopReason {
+        RUNNING,
+        NO_IMPROVEMENT,  // CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT итераций без улучшений
+        GAP_REACHED,     // отклонение от нижней границы не больше CONFIG::OPTIMALITY_GAP
+        DEADLINE,
+        CANCELLED
+    };
+
+private:
+    StopReason stop_reason = RUNNING;
 
 public:
-    // Чтобы избежать лишних вызовов new при операции изменения решения,
-    // передаём в конструктор три динамически созданных объекта расписания:
-    // текущее решение, лучшее найденное решение и измененное решение.
-    // Потом меняем указатели или копируем содержимое в зависимости от значения метрики.
-    // Можно оптимизировать и дальше (избежать одного копирования из текущего решения
-    // в изменяемое решение)
-    SimulateAnnealing(AnnealingSolution* solution
-                     , AnnealingSolution* best_solution
-                     , AnnealingSolution* new_solution
-                     , MutateSolution& mutation
-                     , LowerTemperature& temperature_decrease_law
-                     , double start_temp):
+    // Передаём в конструктор два динамически созданных объекта расписания:
+    // текущее решение и буфер для лучшего найденного решения.
+    // Ход сначала оценивается через MutateSolution::propose и применяется к текущему
+    // решению только если принят. Лучшее решение копируется в буфер только
+    // при обращении к нему или при переполнении журнала отката.
+    BasicSimulateAnnealing(Solution* solution
+                          , Solution* best_solution
+                          , Mutation& mutation
+                          , Law& temperature_decrease_law
+                          , double start_temp):
             solution(solution)
             , best_solution(best_solution)
-            , new_solution(new_solution)
             , mutation(mutation)
             , temperature_decrease_law(temperature_decrease_law)
             , start_temp(start_temp)
             , cur_temp(start_temp)
             , cur_loss(solution->get_loss_metric())
-            , smallest_loss(cur_loss) {}
+            , smallest_loss(cur_loss)
+            , lower_bound(solution->get_loss_lower_bound()) {
+        mutation.clear_journal();
+    }
+    BasicSimulateAnnealing(const BasicSimulateAnnealing&) = delete;
+    BasicSimulateAnnealing& operator=(const BasicSimulateAnnealing&) = delete;
+
+    // Делает запуск воспроизводимым: генератор движка и генератор мутации
+    // получают соседние независимые потоки.
+    void seed(std::uint64_t seed_value, std::uint64_t stream = 0) {
+        gen.seed(seed_value, 2 * stream);
+        uniforms.reset();
+        block_size = block_pos = 0;
+        mutation.seed(seed_value, 2 * stream + 1);
+    }
+
+    // Оценка блоков ходов (CONFIG::MOVE_BLOCK_SIZE > 1) одной цепочки
+    // в threads потоках, 1 - выключить. Окупается на холодной стадии больших
+    // экземпляров, когда блок длинный, а оценка хода - промахи кэша; между
+    // блоками потоки команды ждут, крутясь. Ходы и их порядок те же, что
+    // без спекуляции, поэтому траектория с тем же зерном совпадает.
+    void set_speculation(int threads);
 
     void simulate_annealing();
+    // Подготовка к прогону: если закон калибрует начальную температуру
+    // и прогон ещё не начат, делает пробные ходы. simulate_annealing зовёт
+    // её сам; внешний цикл по step() зовёт её после seed перед первым шагом.
+    void begin();
+    // Одна итерация внешнего цикла simulate_annealing: шаг отжига и понижение
+    // температуры. Возвращает false, когда сработал критерий остановки
+    // (см. get_stop_reason).
+    bool step();
+    StopReason get_stop_reason() const {return stop_reason;}
+
+    // Прогон с ограничениями: останавливается не позже deadline (с точностью
+    // до CONFIG::DEADLINE_CHECK_INTERVAL итераций) или после cancel() у token.
+    // Улучшившееся лучшее решение публикуется в snapshot по ходу прогона
+    // и в конце, читать его можно из других потоков. nullptr отключает
+    // токен и снимок.
+    void set_deadline(std::chrono::steady_clock::time_point time) {
+        deadline = time;
+        limited = true;
+    }
+    void set_cancellation(const CancellationToken* token) {
+        cancellation = token;
+        limited = true;
+    }
+    void set_best_snapshot(BestSnapshot* best) {
+        best_snapshot = best;
+        published_loss = std::numeric_limits<long long>::max();
+        limited = true;
+    }
+
     void print_res() {
+        sync_best();
         best_solution->print();
         std::cout << "Best metric: " << smallest_loss << '\n';
+        if (lower_bound > 0) {
+            std::cout << "Lower bound: " << lower_bound << '\n';
+            std::cout << "Gap: " << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
     }
-    
+
+    // Метрика, число итераций и, если известна нижняя граница, отклонение
+    // от неё. experiment.py читает только первое число.
     void print_loss() {
         std::cout << smallest_loss << '\n';
         std::cout << iter << '\n';
+        if (lower_bound > 0) {
+            std::cout << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
     }
 
+    double get_optimality_gap() const {return optimality_gap(smallest_loss, lower_bound);}
+
+    // Контрольные точки. С set_checkpoint simulate_annealing раз в interval > 0
+    // итераций и в конце записывает состояние в файл; load_checkpoint
+    // продолжает прогон с последней записи так, как будто он не прерывался.
+    // Закон, мутация и экземпляр должны быть теми же, что при записи.
+    // Телеметрия в точку не входит. Запись идёт в потоке отжига и стоит
+    // O(n): лучшее решение материализуется, оба кадра сериализуются
+    // и проходят контрольную сумму (около 7 мс при n = 10^6).
+    std::size_t checkpoint_size() const {
+        return align8(sizeof(Checkpoint)) + align8(mutation.state_size())
+               + 2 * align8(solution->serialized_size());
+    }
+    void set_checkpoint(SnapshotFile* file, long long interval) {
+        assert(interval > 0);
+        snapshot = file;
+        checkpoint_interval = interval;
+    }
+    void save_checkpoint(SnapshotFile&);
+    // false, если в файле нет записей. Несовместимая запись - std::runtime_error.
+    bool load_checkpoint(const SnapshotFile&);
+    long long get_iterations() const {return iter;}
+    long long get_best_loss() const {return smallest_loss;}
+    // Память цепочки в байтах: сам движок, текущее и лучшее решения,
+    // мутация и её копии спекулятивного режима. Общий экземпляр задачи
+    // не входит, так что у k цепочек на одном экземпляре память k * это.
+    std::size_t get_memory_usage() const;
+
+    // Заменяет текущее решение копией migrant (для островной модели).
+    // Лучшее решение сохраняется, если migrant не лучше его.
+    void migrate(const Solution& migrant);
+    // Делает цепочку копией other (для гонки цепочек): текущее и лучшее
+    // решения, температура, доля принятых ходов и счётчики итераций.
+    // Генераторы не копируются, после adopt движок нужно перезасеять.
+    void adopt(BasicSimulateAnnealing& other);
+
     void clear() {
         delete solution;
         delete best_solution;
-        delete new_solution;
     }
 
-    AnnealingSolution* get_solution() {return best_solution;}
+    Solution* get_solution() {
+        sync_best();
+        return best_solution;
+    }
+
+    const AnnealingTelemetry& get_telemetry() const {return telemetry;}
 };
 
-class BoltzmannLaw: public LowerTemperature {
+using SimulateAnnealing = BasicSimulateAnnealing<>;
+
+class BoltzmannLaw final: public LowerTemperature {
 public:
-    double operator()(double, int) const override;
+    double operator()(double temp, int iter) const override {
+        return temp / std::log(1+iter);
+    }
     
     ~BoltzmannLaw() override = default;
 };
 
-class CauchyLaw: public LowerTemperature {
+class CauchyLaw final: public LowerTemperature {
 public:
-    double operator()(double, int) const override;
+    double operator()(double temp, int iter) const override {
+        return temp / (1 + iter);
+    }
 
     ~CauchyLaw() override = default;
 };
 
-class MixedLaw: public LowerTemperature {
+class MixedLaw final: public LowerTemperature {
 public:
-    double operator()(double, int) const override;
+    double operator()(double temp, int iter) const override {
+        return temp * std::log(1 + iter) / (1 + iter);
+    }
 
     ~MixedLaw() override = default;
 };
 
-class ImplAnnealingSolution: public AnnealingSolution {
-    // Более быстрая реализация - использовать вектор связных списков
-    int k;
-    std::vector<int> works;
-    std::vector<std::vector<int>> schedule;
-    std::map<int, int> works_binding;
+// Адаптивный закон. Начальная температура подбирается так, чтобы средний
+// ухудшающий ход принимался с вероятностью initial_acceptance. Пока доля
+// принятых ходов выше target_acceptance, температура падает быстро
+// (fast_cooling), ниже - медленно (slow_cooling), чтобы не тратить итерации
+// ни на случайное блуждание, ни на замороженное решение. Каждые
+// stagnation_iters итераций без улучшения температура поднимается
+// до reheat * start_temp.
+class AdaptiveLaw final: public LowerTemperature {
+    double initial_acceptance;
+    double target_acceptance;
+    double fast_cooling;
+    double slow_cooling;
+    long long stagnation_iters;
+    double reheat;
+    int samples;
 
 public:
-    ImplAnnealingSolution(int k, const std::vector<int>& works): k(k)
-            , works(works)
-            , schedule(k, std::vector<int>()) {
-        std::vector<int> v(works.size());
-        std::iota(v.begin(), v.end(), 0);
-        schedule[0] = v;
-        for (int i = 0; i < works.size(); ++i) {
-            works_binding[i] = 0;
+    explicit AdaptiveLaw(double initial_acceptance = 0.8
+                         , double target_acceptance = 0.05
+                         , double fast_cooling = 0.95
+                         , double slow_cooling = 0.999
+                         , long long stagnation_iters = 250
+                         , double reheat = 0.3
+                         , int samples = 1000): initial_acceptance(initial_acceptance)
+            , target_acceptance(target_acceptance)
+            , fast_cooling(fast_cooling)
+            , slow_cooling(slow_cooling)
+            , stagnation_iters(stagnation_iters)
+            , reheat(reheat)
+            , samples(samples) {}
+
+    // Без обратной связи ведёт себя как BoltzmannLaw.
+    double operator()(double temp, int iter) const override {
+        return temp / std::log(1+iter);
+    }
+
+    int calibration_samples() const override {return samples;}
+
+    double initial_temperature(double mean_uphill, double start_temp) const override {
+        if (mean_uphill <= 0) {
+            return start_temp;
         }
+        return -mean_uphill / std::log(initial_acceptance);
+    }
+
+    double next(double start_temp, int, double cur_temp
+                , double acceptance, long long since_improvement) const override {
+        if (since_improvement > 0 && since_improvement % stagnation_iters == 0) {
+            return std::max(cur_temp, reheat * start_temp);
+        }
+        return cur_temp * (acceptance > target_acceptance ? fast_cooling : slow_cooling);
+    }
+
+    ~AdaptiveLaw() override = default;
+};
+
+// Вызывает f с законом понижения температуры, выбранным по имени, чтобы
+// движок инстанцировался под конкретный закон. По умолчанию - MixedLaw.
+template <class F>
+void visit_law(const std::string& law_type, F&& f) {
+    if (law_type == "boltzmann") {
+        BoltzmannLaw law = BoltzmannLaw();
+        f(law);
+    } else if (law_type == "cauchy") {
+        CauchyLaw law = CauchyLaw();
+        f(law);
+    } else if (law_type == "adaptive") {
+        AdaptiveLaw law = AdaptiveLaw();
+        f(law);
+    } else {
+        MixedLaw law = MixedLaw();
+        f(law);
+    }
+}
+
+class ImplAnnealingSolution final: public AnnealingSolution {
+    // Все структуры плоские: works_binding[w] - процессор работы w,
+    // positions[w] - её индекс в очереди schedule.data(works_binding[w]),
+    // finish[w] - момент её завершения. Порядок очереди при ходах сохраняется:
+    // изменение метрики считается за O(1) по finish, применение хода сдвигает
+    // хвост очереди за O(длина хвоста) и после прогрева не выделяет память.
+    // Длительности берутся из общего экземпляра задачи без копирования,
+    // все очереди лежат в одном массиве QueueArena: на работу приходится
+    // около 21 байта решения независимо от k.
+    std::shared_ptr<const Instance> instance;
+    const std::int32_t* works;
+    int k;
+    QueueArena schedule;
+    std::vector<std::int32_t> works_binding;
+    std::vector<std::int32_t> positions;
+    std::vector<long long> finish;
+
+    // loads[i] - суммарная длительность очереди процессора i.
+    std::vector<long long> loads;
+    long long loss = 0;
+
+    void recompute();
+    // Пересчитывает positions и finish работ очереди proc начиная с from.
+    void refresh(int proc, int from);
+    // Вставка и удаление с сохранением порядка очереди, O(длина хвоста).
+    void erase_at(int proc, int position);
+    void insert_at(int proc, int position, int work);
+    void swap_works(int work, int other);
+    // Начальные расписания на месте решения, без выделения памяти после прогрева.
+    void arrange_spt();
+    void arrange_lpt();
+    void arrange_greedy();
+    void arrange(const std::string& method);
+
+public:
+    // Кадр сериализации: WireHeader, длины очередей uint32[k] и номера работ
+    // int32[n] всех очередей подряд. checksum считается по длинам и номерам.
+    struct WireHeader {
+        std::uint32_t magic;
+        std::uint32_t k;
+        std::uint64_t n;
+        std::uint64_t checksum;
+    };
+    static constexpr std::uint32_t WIRE_MAGIC = 0x44484353;
+
+private:
+    // Проверяет тело кадра и раскладывает его по очередям.
+    void decode(const WireHeader&, const char*);
+
+public:
+    // Виды ходов:
+    // TO_END   - работа work в конец очереди proc;
+    // SWAP     - работы work и other меняются местами;
+    // EXCHANGE - то же для соседних работ одной очереди;
+    // RELOCATE - work переносится в очередь proc на позицию other,
+    //            порядок остальных работ обеих очередей сохраняется.
+    enum MoveType : std::int32_t {TO_END, SWAP, EXCHANGE, RELOCATE, MOVE_TYPES};
+
+    struct Move {
+        int work;
+        int proc;
+        MoveType type = TO_END;
+        int other = 0;
+    };
+
+    // Всё, что нужно для отмены хода: откуда была снята работа
+    // (или с какой работой обменяна) и на сколько изменилась метрика.
+    struct UndoRecord {
+        std::int32_t work;
+        std::int32_t proc;
+        std::int32_t position;
+        std::int32_t other;
+        MoveType type;
+        long long delta;
+    };
+
+    explicit ImplAnnealingSolution(std::shared_ptr<const Instance> instance): instance(instance)
+            , works(instance->durations())
+            , k(instance->procs())
+            , works_binding(instance->size(), 0) {
+        schedule.reset(k, instance->size());
+        std::int32_t* queue = schedule.extend(0, instance->size());
+        std::iota(queue, queue + instance->size(), 0);
+        recompute();
     }
 
-    long long get_loss_metric() const override;
+    ImplAnnealingSolution(int k, const std::vector<int>& works):
+            ImplAnnealingSolution(std::make_shared<const Instance>(
+                    k, std::vector<std::int32_t>(works.begin(), works.end()))) {}
+
+    // Переносит решение на другой экземпляр (все работы на процессоре 0),
+    // переиспользуя уже выделенную память очередей и индексов.
+    void reset(std::shared_ptr<const Instance>);
+
+    // Начальные расписания за O(n log n), чтобы отжиг начинал не с одной очереди.
+    // spt_round_robin: работы по возрастанию длительности раздаются по кругу.
+    static ImplAnnealingSolution spt_round_robin(std::shared_ptr<const Instance>);
+    // lpt: по убыванию длительности на наименее загруженный процессор,
+    // внутри очереди работы идут по возрастанию длительности.
+    static ImplAnnealingSolution lpt(std::shared_ptr<const Instance>);
+    // greedy: в исходном порядке на наименее загруженный процессор,
+    // затем каждая очередь сортируется по возрастанию длительности.
+    static ImplAnnealingSolution greedy(std::shared_ptr<const Instance>);
+    // По имени: single (все работы на процессоре 0), spt, lpt, greedy.
+    // Неизвестное имя - std::runtime_error.
+    static ImplAnnealingSolution initial(std::shared_ptr<const Instance>, const std::string& method);
+    // То же на месте: как reset, переиспользует память решения. При неизвестном
+    // имени решение остаётся со всеми работами на процессоре 0.
+    void reset(std::shared_ptr<const Instance>, const std::string& method);
+
+    long long get_loss_metric() const override {return loss;}
+    long long get_loss_lower_bound() const override {return instance->optimal_loss();}
+    // Изменение метрики при применении хода, O(1) для всех видов.
+    long long move_delta(const Move&) const;
+    // Обмен двух работ: у работы на позиции p очереди длины m вес m - p,
+    // поэтому delta = (d_y - d_x)(m_a - p) + (d_x - d_y)(m_b - q).
+    long long swap_delta(int work, int other) const;
+    // Лучшая позиция для переноса work в очередь proc с сохранением порядка,
+    // O(длина очереди proc). Пишет её в position и возвращает изменение метрики.
+    long long best_relocation(int work, int proc, int& position) const;
+    // Изменение метрики при переносе на заданную позицию.
+    long long relocation_delta(int work, int proc, int position) const;
+    // То же для count ходов сразу: work[i] в конец очереди proc[i].
+    // С AVX2 по восемь ходов за раз, иначе скалярно.
+    void move_deltas(const std::uint32_t* work, const std::uint32_t* proc
+                     , long long* deltas, int count) const;
+    UndoRecord apply_move(const Move& move) {return apply_move(move, move_delta(move));}
+    // Применяет ход с уже посчитанным изменением метрики.
+    UndoRecord apply_move(const Move&, long long delta);
+    // Отменяет последний применённый и ещё не отменённый ход,
+    // за то же время, что и сам ход.
+    void undo_move(const UndoRecord&);
+
     // Похоже на костыль, поведение при перегрузке оператора присваивания мне
     // не до конца понятно.
+    ImplAnnealingSolution(const ImplAnnealingSolution&) = default;
     AnnealingSolution& operator=(const AnnealingSolution& other) override;
     ImplAnnealingSolution& operator=(const ImplAnnealingSolution& other);
+    ImplAnnealingSolution* clone() const override {return new ImplAnnealingSolution(*this);}
 
     void print() const override;
     void to_bytes(int) const override;
     void from_bytes(int) override;
+    std::size_t serialized_size() const override {
+        return sizeof(WireHeader) + (k + instance->size()) * sizeof(std::int32_t);
+    }
+    void serialize(char*) const override;
+    void deserialize(const char*, std::size_t) override;
+    std::size_t memory_usage() const override;
 
     ~ImplAnnealingSolution() override = default;
 
     friend class ImplMutateSolution;
 };
 
-class ImplMutateSolution: public MutateSolution {
-    std::random_device rd;
-    std::mt19937 gen = std::mt19937(rd());
+class ImplMutateSolution final: public MutateSolution {
+public:
+    // Относительные вероятности видов ходов. По умолчанию только TO_END,
+    // тогда вид хода не разыгрывается и последовательность ходов та же,
+    // что и до появления остальных видов.
+    struct MoveWeights {
+        double to_end = 1;
+        double swap = 0;
+        double exchange = 0;
+        double relocate = 0;
+
+        // Формат "end=1,swap=0.5,exchange=0.5,relocate=0.05", пропущенные
+        // виды получают 0. Ошибки сообщаются std::runtime_error.
+        static MoveWeights parse(const std::string&);
+    };
+
+private:
+    // Индексы работ и процессоров генерируются блоками.
+    Xoshiro256 gen;
+    RandomBlock<std::uint32_t> works_block;
+    RandomBlock<std::uint32_t> procs_block;
+    RandomBlock<std::uint32_t> types_block;
+    std::uint32_t works_bound = 0;
+    std::uint32_t procs_bound = 0;
+    ImplAnnealingSolution::Move move{};
+    long long proposed_delta = 0;
+    std::vector<ImplAnnealingSolution::UndoRecord> journal;
+    std::uint32_t block_works[MAX_BLOCK];
+    std::uint32_t block_procs[MAX_BLOCK];
+
+    // Вид хода выбирается сравнением числа из [0, TYPE_SCALE)
+    // с накопленными порогами.
+    static constexpr std::uint32_t TYPE_SCALE = 1 << 16;
+    MoveWeights weights;
+    std::uint32_t thresholds[ImplAnnealingSolution::MOVE_TYPES] = {};
+    bool mixed = false;
+
+    ImplAnnealingSolution::Move random_move(const ImplAnnealingSolution*);
+    long long propose_mixed(const ImplAnnealingSolution*);
     
 public:
+     explicit ImplMutateSolution(std::uint64_t seed_value = random_seed(), std::uint64_t stream = 0):
+            gen(seed_value, stream) {}
+
+     void set_move_weights(const MoveWeights&);
+     const MoveWeights& get_move_weights() const {return weights;}
+
      ImplAnnealingSolution* operator()(AnnealingSolution*, AnnealingSolution*) override;
+     long long propose(const AnnealingSolution*) override;
+     void apply(AnnealingSolution*) override;
+     int propose_block(const AnnealingSolution*, long long*, int) override;
+     void apply_proposed(AnnealingSolution*, int) override;
+     int draw_block(const AnnealingSolution*, int) override;
+     void evaluate_block(const AnnealingSolution*, long long*, int, int) const override;
+
+     size_t journal_size() const override {return journal.size();}
+     std::size_t memory_usage() const override {
+         return journal.capacity() * sizeof(ImplAnnealingSolution::UndoRecord);
+     }
+     void clear_journal() override {journal.clear();}
+     void rollback(AnnealingSolution*) override;
+
+     // Типизированные версии для BasicSimulateAnnealing с ImplAnnealingSolution:
+     // без виртуальных вызовов и dynamic_cast, встраиваются в цикл отжига.
+     long long propose(const ImplAnnealingSolution*);
+     void apply(ImplAnnealingSolution*);
+     int propose_block(const ImplAnnealingSolution*, long long*, int);
+     void apply_proposed(ImplAnnealingSolution*, int);
+     int draw_block(const ImplAnnealingSolution*, int);
+     void evaluate_block(const ImplAnnealingSolution*, long long*, int, int) const;
+     void rollback(ImplAnnealingSolution*);
+
+     ImplMutateSolution* clone() const override;
+     std::size_t state_size() const override;
+     void save_state(char*) const override;
+     void load_state(const char*) override;
+     void seed(std::uint64_t seed_value, std::uint64_t stream) override {
+         gen.seed(seed_value, stream);
+         works_block.reset();
+         procs_block.reset();
+         types_block.reset();
+     }
 
     ~ImplMutateSolution() override = default;
 };
 
+// Горячие функции определены в заголовке, чтобы встраиваться в цикл отжига.
+
+inline long long ImplAnnealingSolution::move_delta(const Move& move) const {
+    switch (move.type) {
+    case SWAP:
+    case EXCHANGE:
+        return swap_delta(move.work, move.other);
+    case RELOCATE:
+        return relocation_delta(move.work, move.proc, move.other);
+    default:
+        break;
+    }
+    int old_proc = works_binding[move.work];
+    long long duration = works[move.work];
+    long long tail = schedule.size(old_proc) - positions[move.work] - 1;
+    // Переносимая работа завершалась в finish, каждая из tail следующих
+    // завершится на duration раньше.
+    long long removed = finish[move.work] + duration * tail;
+    long long new_load = loads[move.proc];
+    if (move.proc == old_proc) {
+        new_load -= duration;
+    }
+    return new_load + duration - removed;
+}
+
+inline long long ImplAnnealingSolution::swap_delta(int work, int other) const {
+    int a = works_binding[work];
+    int b = works_binding[other];
+    long long diff = works[other] - works[work];
+    return diff * (schedule.size(a) - positions[work]) - diff * (schedule.size(b) - positions[other]);
+}
+
+inline ImplAnnealingSolution::UndoRecord ImplAnnealingSolution::apply_move(const Move& move
+                                                                           , long long delta) {
+    loss += delta;
+    int old_proc = works_binding[move.work];
+    UndoRecord undo{move.work, old_proc, positions[move.work], move.other, move.type, delta};
+    if (move.type == SWAP || move.type == EXCHANGE) {
+        swap_works(move.work, move.other);
+        return undo;
+    }
+    erase_at(old_proc, positions[move.work]);
+    insert_at(move.proc, move.type == RELOCATE ? move.other : schedule.size(move.proc), move.work);
+    return undo;
+}
+
+inline ImplAnnealingSolution::Move ImplMutateSolution::random_move(const ImplAnnealingSolution* solution) {
+    // Ход TO_END; другие виды строятся из него в propose_mixed.
+    std::uint32_t n = solution->instance->size();
+    std::uint32_t k = solution->k;
+    if (n != works_bound || k != procs_bound) {
+        works_bound = n;
+        procs_bound = k;
+        works_block.reset();
+        procs_block.reset();
+    }
+
+    int work_num = works_block.next([&](std::uint32_t* out, int count) {
+        gen.fill_below(out, count, n);
+    });
+    int proc_num = procs_block.next([&](std::uint32_t* out, int count) {
+        gen.fill_below(out, count, k);
+    });
+    return {work_num, proc_num};
+}
+
+inline long long ImplMutateSolution::propose(const ImplAnnealingSolution* solution) {
+    if (mixed) {
+        return propose_mixed(solution);
+    }
+    move = random_move(solution);
+    return proposed_delta = solution->move_delta(move);
+}
+
+inline void ImplMutateSolution::apply(ImplAnnealingSolution* solution) {
+    journal.push_back(solution->apply_move(move, proposed_delta));
+}
+
+// Векторная оценка есть только для TO_END, со смесью видов блок из одного
+// хода, и он оценивается сразу при розыгрыше.
+inline int ImplMutateSolution::propose_block(const ImplAnnealingSolution* solution
+                                             , long long* deltas, int count) {
+    count = draw_block(solution, count);
+    evaluate_block(solution, deltas, 0, count);
+    return count;
+}
+
+inline int ImplMutateSolution::draw_block(const ImplAnnealingSolution* solution, int count) {
+    if (mixed) {
+        propose(solution);
+        return 1;
+    }
+    count = std::min(count, int(MAX_BLOCK));
+    gen.fill_below(block_works, count, solution->instance->size());
+    gen.fill_below(block_procs, count, solution->k);
+    return count;
+}
+
+inline void ImplMutateSolution::evaluate_block(const ImplAnnealingSolution* solution
+                                               , long long* deltas, int from, int to) const {
+    if (mixed) {
+        deltas[0] = proposed_delta;
+        return;
+    }
+    solution->move_deltas(block_works + from, block_procs + from, deltas + from, to - from);
+}
+
+inline void ImplMutateSolution::apply_proposed(ImplAnnealingSolution* solution, int index) {
+    if (!mixed) {
+        move = {int(block_works[index]), int(block_procs[index])};
+        proposed_delta = solution->move_delta(move);
+    }
+    apply(solution);
+}
+
+template <class Solution, class Mutation, class Law>
+int BasicSimulateAnnealing<Solution, Mutation, Law>::annealing_step() {
+    if (CONFIG::MOVE_BLOCK_SIZE > 1) {
+        return annealing_block_step();
+    }
+    int accepted = 0;
+    for (int i = 0; i < CONFIG::STEPS_WITHOUT_TEMP_DECREASE; ++i) {
+        telemetry.proposed();
+        long long loss;
+        {
+            ScopedProbe probe(Probe::PROPOSE);
+            loss = cur_loss + mutation.propose(solution);
+        }
+        bool accept = loss <= cur_loss;
+        if (!accept) {
+            ScopedProbe probe(Probe::ACCEPT);
+            long long df = loss - smallest_loss;
+            double p = std::exp(-df / cur_temp);
+            double u = uniforms.next([&](double* out, int count) {
+                gen.fill_uniform(out, count);
+            });
+            accept = u < p;
+        }
+        if (accept) {
+            {
+                ScopedProbe probe(Probe::APPLY);
+                mutation.apply(solution);
+            }
+            replace_solution(loss);
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
+// Ходы берутся из блока по порядку, как если бы предлагались по одному.
+// Критерий в логарифмах: u < exp(-df / T) равносильно x = df / T < -ln u.
+// Из 1 - u <= -ln u <= (1 - u) / u почти все ходы решаются умножением,
+// логарифм нужен только между границами. После принятого хода остаток
+// блока выбрасывается: его изменения метрики посчитаны для старого решения.
+template <class Solution, class Mutation, class Law>
+int BasicSimulateAnnealing<Solution, Mutation, Law>::annealing_block_step() {
+    int accepted = 0;
+    for (int i = 0; i < CONFIG::STEPS_WITHOUT_TEMP_DECREASE; ++i) {
+        if (block_pos == block_size) {
+            // Блок не длиннее ожидаемой серии отказов 1 / acceptance, чтобы
+            // на горячей стадии не выбрасывать почти весь блок.
+            int limit = std::min(CONFIG::MOVE_BLOCK_SIZE, int(MutateSolution::MAX_BLOCK));
+            int count = acceptance * limit > 1 ? int(1 / acceptance) + 1 : limit;
+            ScopedProbe probe(Probe::PROPOSE);
+            if (team != nullptr) {
+                block_size = mutation.draw_block(solution, count);
+                if (block_size >= SPECULATION_MIN_BLOCK) {
+                    team->run(speculate);
+                } else {
+                    mutation.evaluate_block(solution, block_deltas, 0, block_size);
+                }
+            } else {
+                block_size = mutation.propose_block(solution, block_deltas, count);
+            }
+            block_pos = 0;
+        }
+        telemetry.proposed();
+        int index = block_pos++;
+        long long delta = block_deltas[index];
+        long long loss = cur_loss + delta;
+        bool accept = delta <= 0;
+        if (!accept) {
+            ScopedProbe probe(Probe::ACCEPT);
+            double x = (loss - smallest_loss) / cur_temp;
+            double u = uniforms.next([&](double* out, int count) {
+                gen.fill_uniform(out, count);
+            });
+            double rest = 1 - u;
+            accept = x < rest || (x * u < rest && x < -std::log(u));
+        }
+        if (accept) {
+            {
+                ScopedProbe probe(Probe::APPLY);
+                mutation.apply_proposed(solution, index);
+            }
+            replace_solution(loss);
+            block_pos = block_size;
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::set_speculation(int threads) {
+    team.reset();
+    if (threads <= 1) {
+        return;
+    }
+    // Поток t оценивает t-ю долю блока; пустые доли пропускаются.
+    speculate = [this](int t) {
+        int from = std::int64_t(block_size) * t / team->size();
+        int to = std::int64_t(block_size) * (t + 1) / team->size();
+        if (from < to) {
+            mutation.evaluate_block(solution, block_deltas, from, to);
+        }
+    };
+    team = std::make_unique<SpinTeam>(threads);
+}
+
+template <class Solution, class Mutation, class Law>
+std::size_t BasicSimulateAnnealing<Solution, Mutation, Law>::get_memory_usage() const {
+    std::size_t total = sizeof(*this) + solution->memory_usage() + best_solution->memory_usage()
+                        + mutation.memory_usage();
+    return total;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::replace_solution(long long loss) {
+    ScopedProbe probe(Probe::REPLACE);
+    telemetry.accepted(loss > cur_loss, loss < smallest_loss);
+    cur_loss = loss;
+    if (loss < smallest_loss) {
+        iter_with_improvement = iter;
+        smallest_loss = loss;
+        // Лучшее решение теперь совпадает с текущим, копировать ничего не нужно.
+        best_synced = false;
+        mutation.clear_journal();
+        //std::cout << "New loss " << smallest_loss << '\n';
+    } else if (best_synced) {
+        mutation.clear_journal();
+    } else if (mutation.journal_size() > CONFIG::MAX_JOURNAL_SIZE) {
+        sync_best();
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::sync_best() {
+    if (!best_synced) {
+        auto timer = telemetry.phase(AnnealingTelemetry::BEST_SYNC);
+        ScopedProbe probe(Probe::BEST_SYNC);
+        *best_solution = *solution;
+        mutation.rollback(best_solution);
+        best_synced = true;
+    }
+    mutation.clear_journal();
+}
+
+template <class Solution, class Mutation, class Law>
+bool BasicSimulateAnnealing<Solution, Mutation, Law>::step() {
+    ++iter;
+    int accepted = annealing_step();
+    acceptance = 0.9 * acceptance + 0.1 * accepted / CONFIG::STEPS_WITHOUT_TEMP_DECREASE;
+    telemetry.best(iter, smallest_loss, cur_temp);
+    if (iter - iter_with_improvement > CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT) {
+        stop_reason = NO_IMPROVEMENT;
+        return false;
+    }
+    if (optimality_gap_reached(smallest_loss, lower_bound)) {
+        stop_reason = GAP_REACHED;
+        return false;
+    }
+    if (limited && iter % CONFIG::DEADLINE_CHECK_INTERVAL == 0 && limits_reached()) {
+        return false;
+    }
+    ScopedProbe probe(Probe::TEMPERATURE);
+    cur_temp = temperature_decrease_law.next(start_temp, iter, cur_temp
+                                             , acceptance, iter - iter_with_improvement);
+    return true;
+}
+
+template <class Solution, class Mutation, class Law>
+bool BasicSimulateAnnealing<Solution, Mutation, Law>::limits_reached() {
+    if (cancellation != nullptr && cancellation->cancelled()) {
+        stop_reason = CANCELLED;
+        return true;
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max() && best_snapshot == nullptr) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (best_snapshot != nullptr && now >= next_publish) {
+        publish_best();
+        next_publish = now + std::chrono::milliseconds(CONFIG::BEST_PUBLISH_MS);
+    }
+    if (now >= deadline) {
+        stop_reason = DEADLINE;
+        return true;
+    }
+    return false;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::publish_best() {
+    if (best_snapshot == nullptr || smallest_loss >= published_loss) {
+        return;
+    }
+    sync_best();
+    best_solution->serialize(best_snapshot->begin_write());
+    best_snapshot->commit(best_solution->serialized_size(), smallest_loss, iter);
+    published_loss = smallest_loss;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::calibrate() {
+    int samples = temperature_decrease_law.calibration_samples();
+    long long uphill_sum = 0;
+    int uphill = 0;
+    for (int i = 0; i < samples; ++i) {
+        long long delta = mutation.propose(solution);
+        if (delta > 0) {
+            uphill_sum += delta;
+            ++uphill;
+        }
+    }
+    double mean_uphill = uphill ? double(uphill_sum) / uphill : 0;
+    start_temp = cur_temp = temperature_decrease_law.initial_temperature(mean_uphill, start_temp);
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::begin() {
+    if (iter == 0 && temperature_decrease_law.calibration_samples() > 0) {
+        calibrate();
+    }
+    stop_reason = RUNNING;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::simulate_annealing() {
+    auto timer = telemetry.phase(AnnealingTelemetry::RUN);
+    ScopedProbe probe(Probe::RUN);
+    begin();
+    while (step()) {
+        if (snapshot != nullptr && iter % checkpoint_interval == 0) {
+            save_checkpoint(*snapshot);
+        }
+    }
+    sync_best();
+    publish_best();
+    if (snapshot != nullptr) {
+        save_checkpoint(*snapshot);
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::migrate(const Solution& migrant) {
+    // Лучшее решение перестаёт зависеть от текущего и журнала.
+    sync_best();
+    *solution = migrant;
+    cur_loss = solution->get_loss_metric();
+    block_size = block_pos = 0;
+    if (cur_loss < smallest_loss) {
+        smallest_loss = cur_loss;
+        iter_with_improvement = iter;
+        best_synced = false;
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::adopt(BasicSimulateAnnealing& other) {
+    other.sync_best();
+    mutation.clear_journal();
+    *solution = *other.solution;
+    *best_solution = *other.best_solution;
+    best_synced = true;
+    start_temp = other.start_temp;
+    cur_temp = other.cur_temp;
+    acceptance = other.acceptance;
+    cur_loss = other.cur_loss;
+    smallest_loss = other.smallest_loss;
+    iter = other.iter;
+    iter_with_improvement = other.iter_with_improvement;
+    stop_reason = other.stop_reason;
+    block_size = block_pos = 0;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicSimulateAnnealing<Solution, Mutation, Law>::save_checkpoint(SnapshotFile& file) {
+    // Ход цепочки от материализации лучшего решения не зависит.
+    sync_best();
+    Checkpoint header{start_temp, cur_temp, acceptance, cur_loss, smallest_loss
+                      , iter_with_improvement, iter, gen, uniforms, {}, block_size, block_pos
+                      , mutation.state_size(), solution->serialized_size()};
+    std::copy(block_deltas, block_deltas + MutateSolution::MAX_BLOCK, header.block_deltas);
+
+    char* out = file.begin_write();
+    std::memcpy(out, &header, sizeof(header));
+    out += align8(sizeof(header));
+    mutation.save_state(out);
+    out += align8(header.mutation_size);
+    solution->serialize(out);
+    out += align8(header.solution_size);
+    best_solution->serialize(out);
+    file.commit(checkpoint_size());
+}
+
+template <class Solution, class Mutation, class Law>
+bool BasicSimulateAnnealing<Solution, Mutation, Law>::load_checkpoint(const SnapshotFile& file) {
+    if (file.empty()) {
+        return false;
+    }
+    Checkpoint header;
+    if (file.size() != checkpoint_size()) {
+        throw std::runtime_error("Checkpoint doesn't match the instance");
+    }
+    const char* in = file.data();
+    std::memcpy(&header, in, sizeof(header));
+    if (header.mutation_size != mutation.state_size()
+            || header.solution_size != solution->serialized_size()) {
+        throw std::runtime_error("Checkpoint doesn't match the instance");
+    }
+    in += align8(sizeof(header));
+    mutation.load_state(in);
+    in += align8(header.mutation_size);
+    solution->deserialize(in, header.solution_size);
+    in += align8(header.solution_size);
+    best_solution->deserialize(in, header.solution_size);
+
+    start_temp = header.start_temp;
+    cur_temp = header.cur_temp;
+    acceptance = header.acceptance;
+    cur_loss = header.cur_loss;
+    smallest_loss = header.smallest_loss;
+    iter_with_improvement = header.iter_with_improvement;
+    iter = header.iter;
+    gen = header.gen;
+    uniforms = header.uniforms;
+    std::copy(header.block_deltas, header.block_deltas + MutateSolution::MAX_BLOCK, block_deltas);
+    block_size = header.block_size;
+    block_pos = header.block_pos;
+    best_synced = true;
+    mutation.clear_journal();
+    return true;
+}
+
 #endif // SRC_ANNEALING_H_
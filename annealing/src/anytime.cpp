@@ -0,0 +1,69 @@
+#include "anytime.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+BestSnapshot::BestSnapshot(std::size_t capacity): capacity(capacity)
+        , scratch(capacity) {
+    for (Buffer& buffer : buffers) {
+        buffer.words.assign(HEADER_WORDS + (capacity + 7) / 8, 0);
+    }
+}
+
+void BestSnapshot::commit(std::size_t size, long long loss, long long iter) {
+    if (size > capacity) {
+        throw std::runtime_error("Best snapshot frame exceeds capacity");
+    }
+    int next = current.load(std::memory_order_relaxed) == 0 ? 1 : 0;
+    Buffer& buffer = buffers[next];
+    std::uint64_t sequence = buffer.sequence.load(std::memory_order_relaxed);
+    buffer.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::uint64_t header[HEADER_WORDS] = {std::uint64_t(loss), std::uint64_t(iter), size};
+    for (int i = 0; i < HEADER_WORDS; ++i) {
+        std::atomic_ref<std::uint64_t>(buffer.words[i]).store(header[i], std::memory_order_relaxed);
+    }
+    for (std::size_t offset = 0; offset < size; offset += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, scratch.data() + offset, std::min<std::size_t>(8, size - offset));
+        std::atomic_ref<std::uint64_t>(buffer.words[HEADER_WORDS + offset / 8])
+                .store(word, std::memory_order_relaxed);
+    }
+
+    buffer.sequence.store(sequence + 2, std::memory_order_release);
+    current.store(next, std::memory_order_release);
+    best_loss.store(loss, std::memory_order_relaxed);
+}
+
+bool BestSnapshot::read(std::vector<char>& frame, long long* loss, long long* iter) const {
+    std::vector<std::uint64_t> words(buffers[0].words.size());
+    for (;;) {
+        int published = current.load(std::memory_order_acquire);
+        if (published == -1) {
+            return false;
+        }
+        Buffer& buffer = buffers[published];
+        std::uint64_t sequence = buffer.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            words[i] = std::atomic_ref<std::uint64_t>(buffer.words[i]).load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (buffer.sequence.load(std::memory_order_relaxed) == sequence) {
+            break;
+        }
+    }
+    std::size_t size = words[2];
+    frame.resize(size);
+    std::memcpy(frame.data(), words.data() + HEADER_WORDS, size);
+    if (loss != nullptr) {
+        *loss = words[0];
+    }
+    if (iter != nullptr) {
+        *iter = words[1];
+    }
+    return true;
+}
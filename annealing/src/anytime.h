@@ -0,0 +1,59 @@
+#ifndef SRC_ANYTIME_H_
+#define SRC_ANYTIME_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Флаг отмены прогона. cancel() можно звать из другого потока и из
+// обработчика сигнала: флаг - атомарная переменная без блокировок.
+class CancellationToken {
+    std::atomic<bool> flag{false};
+    static_assert(std::atomic<bool>::is_always_lock_free);
+
+public:
+    void cancel() {flag.store(true, std::memory_order_relaxed);}
+    bool cancelled() const {return flag.load(std::memory_order_relaxed);}
+    void reset() {flag.store(false, std::memory_order_relaxed);}
+};
+
+// Лучшее решение идущего прогона для чтения из других потоков. Один
+// писатель (поток отжига) и любое число читателей, никто никого не ждёт.
+// Два буфера под seqlock: запись идёт в буфер, который сейчас не
+// опубликован, читатель копирует опубликованный и повторяет копирование,
+// если за это время буфер начали переписывать. Кадр копируется словами
+// через atomic_ref, так что гонок данных нет и с точки зрения модели памяти.
+class BestSnapshot {
+    struct alignas(64) Buffer {
+        std::atomic<std::uint64_t> sequence{0};
+        // loss, iter, размер кадра в байтах, затем сам кадр.
+        std::vector<std::uint64_t> words;
+    };
+    static constexpr int HEADER_WORDS = 3;
+
+    mutable Buffer buffers[2];
+    std::atomic<int> current{-1};
+    std::atomic<long long> best_loss{std::numeric_limits<long long>::max()};
+    std::size_t capacity;
+    std::vector<char> scratch;
+
+public:
+    // capacity - наибольший размер кадра serialize в байтах.
+    explicit BestSnapshot(std::size_t capacity);
+    BestSnapshot(const BestSnapshot&) = delete;
+    BestSnapshot& operator=(const BestSnapshot&) = delete;
+
+    // Запись писателем: begin_write возвращает собственный буфер писателя на
+    // capacity байт, commit(size, ...) публикует из него кадр.
+    char* begin_write() {return scratch.data();}
+    void commit(std::size_t size, long long loss, long long iter);
+
+    // Метрика последнего опубликованного решения, max(), пока его нет.
+    long long loss() const {return best_loss.load(std::memory_order_relaxed);}
+    // Копирует последний опубликованный кадр в frame; false, если
+    // публикаций ещё не было.
+    bool read(std::vector<char>& frame, long long* loss = nullptr, long long* iter = nullptr) const;
+};
+
+#endif // SRC_ANYTIME_H_
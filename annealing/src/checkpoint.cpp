@@ -0,0 +1,126 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr std::size_t HEADERS_SIZE = sizeof(SnapshotFile::FileHeader)
+                                         + 2 * sizeof(SnapshotFile::SlotHeader);
+
+    // FNV-1a по 64-битным словам, хвост добивается нулями.
+    std::uint64_t snapshot_checksum(const char* data, std::size_t size) {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (std::size_t i = 0; i < size; i += sizeof(std::uint64_t)) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, std::min(sizeof(word), size - i));
+            hash = (hash ^ word) * 0x100000001b3;
+        }
+        return hash;
+    }
+}
+
+
+SnapshotFile::SnapshotFile(const std::string& path, std::size_t capacity_) {
+    // Области выравниваются по 8 байт.
+    capacity = (capacity_ + 7) / 8 * 8;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Can't open snapshot " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("Can't stat snapshot " + path);
+    }
+
+    std::size_t file_size = st.st_size;
+    bool fresh = file_size == 0;
+    FileHeader header{};
+    if (!fresh) {
+        if (file_size < sizeof(header) || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+                || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+                || file_size != HEADERS_SIZE + 2 * header.capacity) {
+            close(fd);
+            throw std::runtime_error("Bad snapshot file " + path);
+        }
+        if (header.capacity < capacity) {
+            close(fd);
+            throw std::runtime_error("Snapshot " + path + " is too small for this instance");
+        }
+        capacity = header.capacity;
+    }
+    mapping_size = HEADERS_SIZE + 2 * capacity;
+    if (fresh && ftruncate(fd, mapping_size) == -1) {
+        close(fd);
+        throw std::runtime_error("Can't resize snapshot " + path);
+    }
+    void* data = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Can't mmap snapshot " + path);
+    }
+    mapping = static_cast<char*>(data);
+
+    if (fresh) {
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.capacity = capacity;
+        std::memcpy(mapping, &header, sizeof(header));
+        return;
+    }
+    // Берём целую запись с большим номером.
+    for (int slot = 0; slot < 2; ++slot) {
+        SlotHeader* slot_head = slot_header(slot);
+        if (slot_head->sequence == 0 || slot_head->size > capacity
+                || snapshot_checksum(slot_data(slot), slot_head->size) != slot_head->checksum) {
+            continue;
+        }
+        if (latest == -1 || slot_head->sequence > sequence) {
+            latest = slot;
+            sequence = slot_head->sequence;
+        }
+    }
+}
+
+SnapshotFile::SlotHeader* SnapshotFile::slot_header(int slot) const {
+    return reinterpret_cast<SlotHeader*>(mapping + sizeof(FileHeader)) + slot;
+}
+
+char* SnapshotFile::slot_data(int slot) const {
+    return mapping + HEADERS_SIZE + slot * capacity;
+}
+
+std::size_t SnapshotFile::size() const {
+    return slot_header(latest)->size;
+}
+
+char* SnapshotFile::begin_write() {
+    return slot_data(latest == 0 ? 1 : 0);
+}
+
+void SnapshotFile::commit(std::size_t size) {
+    if (size > capacity) {
+        throw std::runtime_error("Snapshot doesn't fit into its slot");
+    }
+    int slot = latest == 0 ? 1 : 0;
+    SlotHeader* slot_head = slot_header(slot);
+    // Сначала запись становится недействительной, номер - последним.
+    slot_head->sequence = 0;
+    slot_head->size = size;
+    slot_head->checksum = snapshot_checksum(slot_data(slot), size);
+    std::atomic_ref<std::uint64_t>(slot_head->sequence).store(sequence + 1, std::memory_order_release);
+    ++sequence;
+    latest = slot;
+    msync(mapping, mapping_size, MS_ASYNC);
+}
+
+SnapshotFile::~SnapshotFile() {
+    if (mapping != nullptr) {
+        msync(mapping, mapping_size, MS_ASYNC);
+        munmap(mapping, mapping_size);
+    }
+}
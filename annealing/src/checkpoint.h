@@ -0,0 +1,60 @@
+#ifndef SRC_CHECKPOINT_H_
+#define SRC_CHECKPOINT_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Файл контрольных точек, отображённый в память. Данные хранятся в двух
+// областях, у каждой свой заголовок с номером записи и контрольной суммой.
+// Новая запись идёт в область с более старой записью, а номер в её заголовке
+// пишется последним, поэтому прерванная запись оставляет целой предыдущую
+// точку. На диск страницы сбрасываются асинхронно (msync с MS_ASYNC),
+// цикл отжига сброса не ждёт.
+//
+// Формат: FileHeader, два SlotHeader, две области данных по capacity байт.
+class SnapshotFile {
+public:
+    struct FileHeader {
+        char magic[8];
+        std::uint64_t capacity;
+    };
+    struct SlotHeader {
+        std::uint64_t sequence;
+        std::uint64_t size;
+        std::uint64_t checksum;
+    };
+    static constexpr char MAGIC[8] = {'A', 'N', 'N', 'S', 'N', 'A', 'P', '1'};
+
+private:
+    char* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    std::uint64_t capacity = 0;
+    std::uint64_t sequence = 0;
+    // Область с последней целой записью, -1 - записей нет.
+    int latest = -1;
+
+    SlotHeader* slot_header(int slot) const;
+    char* slot_data(int slot) const;
+
+public:
+    // Открывает существующий файл или создаёт новый с областями по capacity
+    // байт. Файл с меньшими областями или чужой сигнатурой - std::runtime_error.
+    SnapshotFile(const std::string& path, std::size_t capacity);
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    bool empty() const {return latest == -1;}
+    // Последняя целая запись.
+    const char* data() const {return slot_data(latest);}
+    std::size_t size() const;
+
+    // Запись в два шага без промежуточного буфера: begin_write возвращает
+    // свободную область на capacity байт, commit(size) считает контрольную
+    // сумму и публикует запись.
+    char* begin_write();
+    void commit(std::size_t size);
+
+    ~SnapshotFile();
+};
+
+#endif // SRC_CHECKPOINT_H_
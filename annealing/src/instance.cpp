@@ -0,0 +1,187 @@
+#include "instance.h"
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Файл целиком отображается в память только для чтения.
+    // Пустой файл отображается в nullptr.
+    std::pair<void*, std::size_t> map_file(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("Can't open file " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            close(fd);
+            throw std::runtime_error("Can't stat file " + path);
+        }
+        std::size_t size = st.st_size;
+        void* data = nullptr;
+        if (size != 0) {
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Can't mmap file " + path);
+        }
+        return {data, size};
+    }
+
+    bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+}
+
+
+Instance::Instance(int k, std::vector<std::int32_t> works_): k(k)
+        , n(works_.size())
+        , works(nullptr)
+        , owned(std::move(works_)) {
+    if (k <= 0) {
+        throw std::invalid_argument("Processor count must be positive");
+    }
+    if (owned.empty()) {
+        throw std::invalid_argument("Instance has no works");
+    }
+    if (std::any_of(owned.begin(), owned.end(), [](std::int32_t work) {return work < 0;})) {
+        throw std::invalid_argument("Negative work duration");
+    }
+    works = owned.data();
+}
+
+std::shared_ptr<const Instance> Instance::from_csv(const std::string& path) {
+    auto [data, size] = map_file(path);
+    const char* cur = static_cast<const char*>(data);
+    const char* end = cur + size;
+
+    // Первое число - k, дальше длительности; разделители любые, но минус
+    // перед цифрой - знак, а отрицательных длительностей не бывает.
+    std::vector<std::int32_t> values;
+    values.reserve(size / 3);
+    while (cur < end) {
+        if (*cur == '-' && cur + 1 < end && is_digit(cur[1])) {
+            munmap(data, size);
+            throw std::runtime_error("Negative number in " + path);
+        }
+        if (!is_digit(*cur)) {
+            ++cur;
+            continue;
+        }
+        std::int32_t value;
+        auto [next, ec] = std::from_chars(cur, end, value);
+        if (ec != std::errc()) {
+            munmap(data, size);
+            throw std::runtime_error("Bad number in " + path);
+        }
+        values.push_back(value);
+        cur = next;
+    }
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+    if (values.empty() || values[0] <= 0) {
+        throw std::runtime_error("No processor count in " + path);
+    }
+    if (values.size() == 1) {
+        throw std::runtime_error("No works in " + path);
+    }
+    int k = values[0];
+    values.erase(values.begin());
+    return std::make_shared<Instance>(k, std::move(values));
+}
+
+std::shared_ptr<const Instance> Instance::from_binary(const std::string& path) {
+    auto [data, size] = map_file(path);
+    BinaryHeader header;
+    if (size < sizeof(header)) {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+        throw std::runtime_error("Truncated instance header in " + path);
+    }
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t max_works = (std::numeric_limits<std::size_t>::max() - sizeof(header)) / sizeof(std::int32_t);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.k == 0
+            || header.k > std::uint32_t(std::numeric_limits<std::int32_t>::max())
+            || header.n == 0 || header.n > max_works
+            || size != sizeof(header) + header.n * sizeof(std::int32_t)) {
+        munmap(data, size);
+        throw std::runtime_error("Bad binary instance " + path);
+    }
+    std::shared_ptr<Instance> instance(new Instance());
+    instance->k = header.k;
+    instance->n = header.n;
+    instance->works = reinterpret_cast<const std::int32_t*>(
+            static_cast<const char*>(data) + sizeof(header));
+    instance->mapping = data;
+    instance->mapping_size = size;
+    return instance;
+}
+
+std::shared_ptr<const Instance> Instance::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Can't open file " + path);
+    }
+    char magic[sizeof(MAGIC)] = {};
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+    if (got == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0) {
+        return from_binary(path);
+    }
+    return from_csv(path);
+}
+
+void Instance::save_binary(const std::string& path) const {
+    BinaryHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.k = k;
+    header.n = n;
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Can't create file " + path);
+    }
+    const char* chunks[] = {reinterpret_cast<const char*>(&header),
+                            reinterpret_cast<const char*>(works)};
+    std::size_t sizes[] = {sizeof(header), n * sizeof(std::int32_t)};
+    for (int i = 0; i < 2; ++i) {
+        std::size_t done = 0;
+        while (done < sizes[i]) {
+            ssize_t written = write(fd, chunks[i] + done, sizes[i] - done);
+            if (written <= 0) {
+                close(fd);
+                throw std::runtime_error("Can't write file " + path);
+            }
+            done += written;
+        }
+    }
+    close(fd);
+}
+
+long long Instance::optimal_loss() const {
+    std::call_once(optimum_once, [&]() {
+        std::vector<std::int32_t> sorted(works, works + n);
+        std::sort(sorted.begin(), sorted.end(), std::greater<std::int32_t>());
+        long long total = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            total += sorted[i] * (long long)(i / k + 1);
+        }
+        optimum = total;
+    });
+    return optimum;
+}
+
+Instance::~Instance() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef SRC_INSTANCE_H_
+#define SRC_INSTANCE_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Экземпляр задачи: число процессоров и длительности работ.
+// Длительности лежат одним массивом int32 и только читаются, поэтому один
+// экземпляр разделяют все решения. Массив либо принадлежит экземпляру,
+// либо отображён из бинарного файла через mmap и используется на месте.
+//
+// Бинарный формат: заголовок BinaryHeader, сразу за ним n значений int32
+// в порядке байт машины.
+class Instance {
+    int k;
+    std::size_t n;
+    const std::int32_t* works;
+    std::vector<std::int32_t> owned;
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    mutable std::once_flag optimum_once;
+    mutable long long optimum = 0;
+
+    Instance(): k(0), n(0), works(nullptr) {}
+
+public:
+    struct BinaryHeader {
+        char magic[8];
+        std::uint32_t k;
+        std::uint32_t reserved;
+        std::uint64_t n;
+    };
+    static constexpr char MAGIC[8] = {'A', 'N', 'N', 'I', 'N', 'S', 'T', '1'};
+
+    // Те же проверки, что у загрузчиков: k > 0, хотя бы одна работа,
+    // длительности неотрицательны; иначе std::invalid_argument.
+    Instance(int k, std::vector<std::int32_t> works);
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
+    // Ошибки чтения и формата сообщаются исключением std::runtime_error,
+    // как и экземпляры без работ и с отрицательными длительностями
+    // в CSV. Бинарный файл не просматривается целиком и таких проверок
+    // длительностей не делает.
+    static std::shared_ptr<const Instance> from_csv(const std::string& path);
+    static std::shared_ptr<const Instance> from_binary(const std::string& path);
+    // Формат определяется по сигнатуре в начале файла.
+    static std::shared_ptr<const Instance> load(const std::string& path);
+
+    void save_binary(const std::string& path) const;
+
+    int procs() const {return k;}
+    std::size_t size() const {return n;}
+    const std::int32_t* durations() const {return works;}
+    std::int32_t operator[](std::size_t i) const {return works[i];}
+
+    // Оптимальная сумма моментов завершения на k одинаковых процессорах.
+    // i-я по убыванию работа (с нуля) в оптимуме стоит (i / k)-й с конца
+    // своей очереди и входит в сумму с весом i / k + 1; такое расписание
+    // строит ImplAnnealingSolution::spt_round_robin. Считается один раз
+    // при первом обращении за O(n log n), потокобезопасно.
+    long long optimal_loss() const;
+
+    ~Instance();
+};
+
+#endif // SRC_INSTANCE_H_
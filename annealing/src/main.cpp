@@ -2,6 +2,7 @@
 #include <vector>
 
 int main() {
+    ProfileReport profile;
     ImplAnnealingSolution* ann = new ImplAnnealingSolution(10, std::vector({53, 95, 68, 81, 70, 84, 78, 51, 88, 83, 89, 66, 64, 74, 78, 92,
             51, 59, 62, 89, 60, 66, 84, 93, 98, 78, 52, 99, 93, 63, 76, 71,
             53, 59, 65, 94, 59, 55, 93, 54, 57, 68, 64, 70, 71, 93, 88, 71,
@@ -11,10 +12,9 @@ int main() {
             93, 93, 97, 74, 61, 62, 58, 84, 98, 76, 76, 85, 81, 84, 75, 87,
             87, 63, 67, 84, 77, 64, 83, 75, 83, 85, 66, 57, 84, 73, 98, 62}));
     ImplAnnealingSolution* best_ann = new ImplAnnealingSolution(*ann);
-    ImplAnnealingSolution* new_ann = new ImplAnnealingSolution(*ann);
     ImplMutateSolution mut = ImplMutateSolution();
     CauchyLaw law = CauchyLaw();
-    SimulateAnnealing sim = SimulateAnnealing(ann, best_ann, new_ann, mut, law, 1000);
+    SimulateAnnealing sim = SimulateAnnealing(ann, best_ann, mut, law, 1000);
     sim.simulate_annealing();
     sim.print_res();
     sim.clear();
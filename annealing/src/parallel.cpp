@@ -0,0 +1,140 @@
+#include "parallel.h"
+
+namespace CONFIG {
+    int MAX_ROUNDS_WITHOUT_IMPROVEMENT = 10;
+    int REPLICA_EXCHANGE_INTERVAL = 1000;
+    // Итераций отжига острова между обращениями к доске мигрантов.
+    int MIGRATION_INTERVAL = 100;
+    // Итераций каждой цепочки гонки между отсевами.
+    int RACE_INTERVAL = 2000;
+}
+
+
+ThreadPool::ThreadPool(int threads) {
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+void ThreadPool::worker_loop(int id) {
+    long long seen = 0;
+    while (1) {
+        const std::function<void(int)>* cur_job;
+        {
+            std::unique_lock lock(m);
+            start_cv.wait(lock, [&] {return stop || generation != seen;});
+            if (stop) {
+                return;
+            }
+            seen = generation;
+            cur_job = job;
+        }
+        (*cur_job)(id);
+        {
+            std::lock_guard lock(m);
+            if (--pending == 0) {
+                done_cv.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::run(const std::function<void(int)>& new_job) {
+    std::unique_lock lock(m);
+    job = &new_job;
+    pending = workers.size();
+    ++generation;
+    start_cv.notify_all();
+    done_cv.wait(lock, [&] {return pending == 0;});
+    job = nullptr;
+}
+
+WorkStealingPool::WorkStealingPool(int threads): queues(threads) {
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&WorkStealingPool::worker_loop, this, i);
+    }
+}
+
+void WorkStealingPool::submit(std::function<void(int)> task) {
+    Queue& queue = queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard lock(queue.m);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(m);
+        ++queued;
+        ++unfinished;
+    }
+    work_cv.notify_one();
+}
+
+bool WorkStealingPool::take(int id, std::function<void(int)>& task) {
+    for (std::size_t attempt = 0; attempt < queues.size(); ++attempt) {
+        Queue& queue = queues[(id + attempt) % queues.size()];
+        {
+            std::lock_guard lock(queue.m);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (attempt == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+        std::lock_guard lock(m);
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(int id) {
+    std::function<void(int)> task;
+    while (1) {
+        if (take(id, task)) {
+            task(id);
+            task = nullptr;
+            std::lock_guard lock(m);
+            if (--unfinished == 0) {
+                done_cv.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock lock(m);
+        work_cv.wait(lock, [&] {return stop || queued > 0;});
+        if (stop && queued == 0) {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock lock(m);
+    done_cv.wait(lock, [&] {return unfinished == 0;});
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(m);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
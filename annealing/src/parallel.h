@@ -0,0 +1,939 @@
+#ifndef SRC_PARALLEL_H_
+#define SRC_PARALLEL_H_
+#include "annealing.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CONFIG {
+    extern int MAX_ROUNDS_WITHOUT_IMPROVEMENT;
+    extern int REPLICA_EXCHANGE_INTERVAL;
+    extern int MIGRATION_INTERVAL;
+    extern int RACE_INTERVAL;
+}
+
+// Пул из постоянных потоков: run запускает job(i) в потоке i для всех
+// потоков сразу и ждёт, пока все закончат. Потоки создаются один раз
+// и между вызовами run спят на condition_variable.
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const std::function<void(int)>* job = nullptr;
+    long long generation = 0;
+    int pending = 0;
+    bool stop = false;
+
+    void worker_loop(int);
+
+public:
+    explicit ThreadPool(int threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void run(const std::function<void(int)>& job);
+    int size() const {return workers.size();}
+
+    ~ThreadPool();
+};
+
+// Пул для потока независимых задач разной длины (запросы решателя,
+// прогоны сетки параметров). У каждого потока своя очередь: submit
+// раскладывает задачи по очередям по кругу, владелец берёт из своей
+// старые задачи, простаивающий поток забирает у других самые новые.
+// Задача получает номер выполняющего потока, чтобы брать его буферы.
+// Деструктор дорабатывает все отправленные задачи.
+class WorkStealingPool {
+    struct alignas(64) Queue {
+        std::mutex m;
+        std::deque<std::function<void(int)>> tasks;
+    };
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> next_queue{0};
+    std::mutex m;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    // Отправлены, но ещё не взяты; отправлены, но ещё не выполнены.
+    long long queued = 0;
+    long long unfinished = 0;
+    bool stop = false;
+
+    bool take(int, std::function<void(int)>&);
+    void worker_loop(int);
+
+public:
+    explicit WorkStealingPool(int threads);
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(std::function<void(int)> task);
+    // Ждёт, пока выполнятся все отправленные задачи.
+    void wait();
+    int size() const {return workers.size();}
+
+    ~WorkStealingPool();
+};
+
+// Несколько независимых цепочек отжига в потоках одного процесса.
+// Раунд: каждая цепочка стартует с глобально лучшего решения и работает
+// до своего критерия остановки, затем лучшее решение раунда становится
+// глобальным. Останавливаемся после CONFIG::MAX_ROUNDS_WITHOUT_IMPROVEMENT
+// раундов без улучшения или когда отклонение от нижней границы
+// не больше CONFIG::OPTIMALITY_GAP.
+template <class Solution = AnnealingSolution
+          , class Mutation = MutateSolution
+          , class Law = LowerTemperature>
+class BasicParallelSimulateAnnealing {
+    // Буферы цепочки создаются в её потоке и выровнены по кэш-линии,
+    // чтобы соседние цепочки не делили строки кэша.
+    struct alignas(64) Chain {
+        Solution* solution = nullptr;
+        Solution* best_solution = nullptr;
+        Mutation* mutation = nullptr;
+        long long best_loss = 0;
+    };
+
+    std::vector<Chain> chains;
+    Solution* best_solution;
+    Law& temperature_decrease_law;
+    double start_temp;
+    std::uint64_t seed;
+    long long smallest_loss;
+    long long lower_bound;
+    long long rounds = 0;
+    ThreadPool pool;
+
+public:
+    BasicParallelSimulateAnnealing(const Solution& solution
+                                  , const Mutation& mutation
+                                  , Law& temperature_decrease_law
+                                  , double start_temp
+                                  , int threads
+                                  , std::uint64_t seed = random_seed());
+    BasicParallelSimulateAnnealing(const BasicParallelSimulateAnnealing&) = delete;
+    BasicParallelSimulateAnnealing& operator=(const BasicParallelSimulateAnnealing&) = delete;
+
+    void simulate_annealing();
+    void print_res() const {
+        best_solution->print();
+        std::cout << "Best metric: " << smallest_loss << '\n';
+        if (lower_bound > 0) {
+            std::cout << "Lower bound: " << lower_bound << '\n';
+            std::cout << "Gap: " << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    void print_loss() const {
+        std::cout << smallest_loss << '\n';
+        std::cout << rounds << '\n';
+        if (lower_bound > 0) {
+            std::cout << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    Solution* get_solution() {return best_solution;}
+    // Буферы самой большой цепочки в байтах (решения и мутация, без общего
+    // экземпляра задачи); 0 до первого раунда.
+    std::size_t chain_memory_usage() const {
+        std::size_t usage = 0;
+        for (const Chain& chain : chains) {
+            if (chain.solution != nullptr) {
+                usage = std::max(usage, chain.solution->memory_usage() + chain.best_solution->memory_usage()
+                                        + chain.mutation->memory_usage());
+            }
+        }
+        return usage;
+    }
+
+    ~BasicParallelSimulateAnnealing();
+};
+
+using ParallelSimulateAnnealing = BasicParallelSimulateAnnealing<>;
+
+// Параллельный отжиг (replica exchange): лестница цепочек при постоянных
+// температурах, по потоку на цепочку. Каждые CONFIG::REPLICA_EXCHANGE_INTERVAL
+// шагов соседние по температуре цепочки обмениваются решениями по критерию
+// Метрополиса. Обмен реализован перестановкой температур, сами решения
+// не копируются.
+template <class Solution = AnnealingSolution, class Mutation = MutateSolution>
+class BasicReplicaExchangeAnnealing {
+    struct alignas(64) Replica {
+        Solution* solution = nullptr;
+        Solution* best_solution = nullptr;
+        Mutation* mutation = nullptr;
+        double temp = 0;
+        long long cur_loss = 0;
+        long long best_loss = 0;
+        // Как в SimulateAnnealing: пока best_synced == false, лучшее решение
+        // равно текущему с откаченным журналом мутации.
+        bool best_synced = false;
+        Xoshiro256 gen;
+    };
+
+    std::vector<Replica> replicas;
+    // ladder[i] - номер цепочки, работающей при i-й по возрастанию температуре.
+    std::vector<int> ladder;
+    std::vector<double> temperatures;
+    std::vector<long long> swap_attempts;
+    std::vector<long long> swap_accepts;
+    Solution* best_solution;
+    long long smallest_loss;
+    long long lower_bound;
+    long long exchanges = 0;
+    Xoshiro256 gen;
+    ThreadPool pool;
+
+    static void run_replica(Replica&, int steps);
+    static void sync_best(Replica&);
+    void exchange();
+
+public:
+    // Температуры лестницы - геометрическая прогрессия от min_temp до max_temp.
+    BasicReplicaExchangeAnnealing(const Solution& solution
+                                 , const Mutation& mutation
+                                 , double min_temp
+                                 , double max_temp
+                                 , int replicas
+                                 , std::uint64_t seed = random_seed());
+    BasicReplicaExchangeAnnealing(const BasicReplicaExchangeAnnealing&) = delete;
+    BasicReplicaExchangeAnnealing& operator=(const BasicReplicaExchangeAnnealing&) = delete;
+
+    // Работает, пока не истечёт seconds секунд или отклонение лучшей
+    // цепочки от нижней границы не станет не больше CONFIG::OPTIMALITY_GAP.
+    void simulate_annealing(double seconds);
+    void print_res() const {
+        best_solution->print();
+        std::cout << "Best metric: " << smallest_loss << '\n';
+        if (lower_bound > 0) {
+            std::cout << "Lower bound: " << lower_bound << '\n';
+            std::cout << "Gap: " << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    void print_loss() const {
+        std::cout << smallest_loss << '\n';
+        std::cout << exchanges << '\n';
+        if (lower_bound > 0) {
+            std::cout << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    // Доля принятых обменов для каждой пары соседних температур,
+    // по ней подбирается лестница.
+    void print_swap_rates() const;
+
+    Solution* get_solution() {return best_solution;}
+    // То же, что BasicParallelSimulateAnnealing::chain_memory_usage.
+    std::size_t chain_memory_usage() const {
+        std::size_t usage = 0;
+        for (const Replica& replica : replicas) {
+            if (replica.solution != nullptr) {
+                usage = std::max(usage, replica.solution->memory_usage() + replica.best_solution->memory_usage()
+                                        + replica.mutation->memory_usage());
+            }
+        }
+        return usage;
+    }
+
+    ~BasicReplicaExchangeAnnealing();
+};
+
+using ReplicaExchangeAnnealing = BasicReplicaExchangeAnnealing<>;
+
+// Схема миграции островов: кольцо или лучшее решение всем.
+enum class MigrationTopology {RING, BROADCAST};
+
+// Островная модель: острова - цепочки отжига в своих потоках - работают без
+// общих барьеров, пока не истечёт время. Раз в CONFIG::MIGRATION_INTERVAL
+// итераций остров выкладывает на доску своё лучшее решение, если оно
+// улучшилось, и берёт с доски мигранта: в кольце (RING) - от предыдущего
+// острова, при BROADCAST - лучшее решение доски. Мигрант заменяет текущее
+// решение, только если он лучше лучшего решения острова. Слоты доски
+// захватываются через try_lock: занятый слот пропускается до следующей
+// миграции, так что остров никогда не ждёт остальных. Остыв, остров
+// начинает отжиг заново со своего лучшего решения.
+template <class Solution = AnnealingSolution
+          , class Mutation = MutateSolution
+          , class Law = LowerTemperature>
+class BasicIslandAnnealing {
+    struct alignas(64) Slot {
+        std::mutex m;
+        Solution* solution = nullptr;
+        std::atomic<long long> loss{0};
+        std::atomic<std::uint64_t> version{0};
+    };
+
+    struct alignas(64) Island {
+        Solution* solution = nullptr;
+        Solution* best_solution = nullptr;
+        Solution* migrant = nullptr;
+        Mutation* mutation = nullptr;
+        long long best_loss = 0;
+        long long migrations = 0;
+        long long restarts = 0;
+    };
+
+    using Engine = BasicSimulateAnnealing<Solution, Mutation, Law>;
+
+    std::vector<Slot> board;
+    std::vector<Island> islands;
+    MigrationTopology topology;
+    Law& temperature_decrease_law;
+    double start_temp;
+    std::uint64_t seed;
+    Solution* best_solution;
+    long long smallest_loss;
+    long long lower_bound;
+    std::atomic<bool> done{false};
+    ThreadPool pool;
+
+    void run_island(int, std::chrono::steady_clock::time_point deadline);
+    void publish(int, Engine&);
+    void pull(int, Engine&, std::vector<std::uint64_t>& seen);
+
+public:
+    BasicIslandAnnealing(const Solution& solution
+                        , const Mutation& mutation
+                        , Law& temperature_decrease_law
+                        , double start_temp
+                        , int islands
+                        , MigrationTopology topology = MigrationTopology::RING
+                        , std::uint64_t seed = random_seed());
+    BasicIslandAnnealing(const BasicIslandAnnealing&) = delete;
+    BasicIslandAnnealing& operator=(const BasicIslandAnnealing&) = delete;
+
+    // Работает, пока не истечёт seconds секунд или какой-нибудь остров
+    // не приблизится к нижней границе на CONFIG::OPTIMALITY_GAP.
+    void simulate_annealing(double seconds);
+    void print_res() const {
+        best_solution->print();
+        std::cout << "Best metric: " << smallest_loss << '\n';
+        if (lower_bound > 0) {
+            std::cout << "Lower bound: " << lower_bound << '\n';
+            std::cout << "Gap: " << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    // Метрика, число принятых мигрантов и отклонение от нижней границы.
+    void print_loss() const {
+        long long migrations = 0;
+        for (const Island& island : islands) {
+            migrations += island.migrations;
+        }
+        std::cout << smallest_loss << '\n';
+        std::cout << migrations << '\n';
+        if (lower_bound > 0) {
+            std::cout << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    Solution* get_solution() {return best_solution;}
+    // То же для острова, вместе с буфером мигранта; слоты доски не входят.
+    std::size_t chain_memory_usage() const {
+        std::size_t usage = 0;
+        for (const Island& island : islands) {
+            if (island.solution != nullptr) {
+                usage = std::max(usage, island.solution->memory_usage() + island.best_solution->memory_usage()
+                                        + island.migrant->memory_usage() + island.mutation->memory_usage());
+            }
+        }
+        return usage;
+    }
+
+    ~BasicIslandAnnealing();
+};
+
+using IslandAnnealing = BasicIslandAnnealing<>;
+
+// Гонка цепочек (racing): много коротких цепочек с разными потоками
+// генератора стартуют с одного решения и работают по CONFIG::RACE_INTERVAL
+// итераций между отсевами. На отсеве идущие цепочки ранжируются по лучшей
+// метрике, худшая половина снимается, и на место снятых встают копии
+// лучших (BasicSimulateAnnealing::adopt) со свежими потоками генератора.
+// Остывшие цепочки тоже уступают место копиям. Число цепочек, а с ним
+// и расход процессора, не меняется, но время проигравших уходит на
+// продолжение перспективных состояний. Когда остывают все, начинается
+// новый заезд: все цепочки заново с лучшего решения при начальной
+// температуре. Бюджет - общее число итераций всех цепочек; гонка кончается
+// раньше после CONFIG::MAX_ROUNDS_WITHOUT_IMPROVEMENT заездов без улучшения
+// или по CONFIG::OPTIMALITY_GAP. Цепочка всегда считается в потоке с номером c % threads,
+// а отсев идёт между раундами, поэтому результат не зависит ни от числа
+// потоков, ни от их планирования.
+template <class Solution = AnnealingSolution
+          , class Mutation = MutateSolution
+          , class Law = LowerTemperature>
+class BasicRacingAnnealing {
+    using Engine = BasicSimulateAnnealing<Solution, Mutation, Law>;
+
+    struct alignas(64) Racer {
+        Solution* solution = nullptr;
+        Solution* best_solution = nullptr;
+        Mutation* mutation = nullptr;
+        Engine* sim = nullptr;
+        bool running = true;
+        long long steps = 0;
+    };
+
+    std::vector<Racer> racers;
+    Law& temperature_decrease_law;
+    double start_temp;
+    std::uint64_t seed;
+    Solution* best_solution;
+    long long smallest_loss;
+    long long lower_bound;
+    long long rounds = 0;
+    long long clones = 0;
+    long long legs = 1;
+    ThreadPool pool;
+
+    // Снимает худшую половину идущих цепочек и остывшие, на их место - копии лучших.
+    void cull();
+    // Новый заезд всех цепочек с лучшего решения.
+    void restart();
+
+public:
+    BasicRacingAnnealing(const Solution& solution
+                        , const Mutation& mutation
+                        , Law& temperature_decrease_law
+                        , double start_temp
+                        , int chains
+                        , int threads
+                        , std::uint64_t seed = random_seed());
+    BasicRacingAnnealing(const BasicRacingAnnealing&) = delete;
+    BasicRacingAnnealing& operator=(const BasicRacingAnnealing&) = delete;
+
+    // Тратит до budget итераций на все цепочки вместе.
+    void simulate_annealing(long long budget);
+    void print_res() const {
+        best_solution->print();
+        std::cout << "Best metric: " << smallest_loss << '\n';
+        if (lower_bound > 0) {
+            std::cout << "Lower bound: " << lower_bound << '\n';
+            std::cout << "Gap: " << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    // Метрика, число копирований цепочек, число заездов и отклонение
+    // от нижней границы.
+    void print_loss() const {
+        std::cout << smallest_loss << '\n';
+        std::cout << clones << '\n';
+        std::cout << legs << '\n';
+        if (lower_bound > 0) {
+            std::cout << optimality_gap(smallest_loss, lower_bound) << '\n';
+        }
+    }
+
+    Solution* get_solution() {return best_solution;}
+    // Память самой большой цепочки вместе с её движком.
+    std::size_t chain_memory_usage() const {
+        std::size_t usage = 0;
+        for (const Racer& racer : racers) {
+            usage = std::max(usage, racer.sim->get_memory_usage());
+        }
+        return usage;
+    }
+
+    ~BasicRacingAnnealing();
+};
+
+using RacingAnnealing = BasicRacingAnnealing<>;
+
+
+template <class Solution, class Mutation, class Law>
+BasicParallelSimulateAnnealing<Solution, Mutation, Law>::BasicParallelSimulateAnnealing(const Solution& solution
+        , const Mutation& mutation
+        , Law& temperature_decrease_law
+        , double start_temp
+        , int threads
+        , std::uint64_t seed):
+        chains(threads)
+        , best_solution(solution.clone())
+        , temperature_decrease_law(temperature_decrease_law)
+        , start_temp(start_temp)
+        , seed(seed)
+        , smallest_loss(solution.get_loss_metric())
+        , lower_bound(solution.get_loss_lower_bound())
+        , pool(threads) {
+    pool.run([&](int i) {
+        Chain& chain = chains[i];
+        chain.solution = solution.clone();
+        chain.best_solution = solution.clone();
+        chain.mutation = mutation.clone();
+    });
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicParallelSimulateAnnealing<Solution, Mutation, Law>::simulate_annealing() {
+    int without_improvement = 0;
+    std::function<void(int)> round = [&](int i) {
+        Chain& chain = chains[i];
+        *chain.solution = *best_solution;
+        BasicSimulateAnnealing<Solution, Mutation, Law> sim(chain.solution, chain.best_solution
+                                                            , *chain.mutation
+                                                            , temperature_decrease_law, start_temp);
+        // Своя пара потоков генератора на каждую цепочку и раунд.
+        sim.seed(seed + rounds, i);
+        sim.simulate_annealing();
+        chain.best_loss = sim.get_solution()->get_loss_metric();
+    };
+
+    while (without_improvement < CONFIG::MAX_ROUNDS_WITHOUT_IMPROVEMENT
+            && !optimality_gap_reached(smallest_loss, lower_bound)) {
+        ++rounds;
+        ++without_improvement;
+        pool.run(round);
+
+        const Chain* best_chain = nullptr;
+        for (const Chain& chain : chains) {
+            if (chain.best_loss < smallest_loss) {
+                smallest_loss = chain.best_loss;
+                best_chain = &chain;
+            }
+        }
+        if (best_chain != nullptr) {
+            *best_solution = *best_chain->best_solution;
+            without_improvement = 0;
+        }
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+BasicParallelSimulateAnnealing<Solution, Mutation, Law>::~BasicParallelSimulateAnnealing() {
+    for (Chain& chain : chains) {
+        delete chain.solution;
+        delete chain.best_solution;
+        delete chain.mutation;
+    }
+    delete best_solution;
+}
+
+
+template <class Solution, class Mutation>
+BasicReplicaExchangeAnnealing<Solution, Mutation>::BasicReplicaExchangeAnnealing(const Solution& solution
+        , const Mutation& mutation
+        , double min_temp
+        , double max_temp
+        , int replica_count
+        , std::uint64_t seed):
+        replicas(replica_count)
+        , ladder(replica_count)
+        , temperatures(replica_count)
+        , swap_attempts(replica_count, 0)
+        , swap_accepts(replica_count, 0)
+        , best_solution(solution.clone())
+        , smallest_loss(solution.get_loss_metric())
+        , lower_bound(solution.get_loss_lower_bound())
+        , gen(seed, 2 * replica_count)
+        , pool(replica_count) {
+    for (int i = 0; i < replica_count; ++i) {
+        double ratio = replica_count > 1 ? double(i) / (replica_count - 1) : 0;
+        temperatures[i] = min_temp * std::pow(max_temp / min_temp, ratio);
+        ladder[i] = i;
+    }
+    pool.run([&](int i) {
+        Replica& replica = replicas[i];
+        replica.solution = solution.clone();
+        replica.best_solution = solution.clone();
+        replica.mutation = mutation.clone();
+        replica.mutation->seed(seed, 2 * i + 1);
+        replica.temp = temperatures[i];
+        replica.cur_loss = replica.best_loss = smallest_loss;
+        replica.gen.seed(seed, 2 * i);
+    });
+}
+
+template <class Solution, class Mutation>
+void BasicReplicaExchangeAnnealing<Solution, Mutation>::run_replica(Replica& replica, int steps) {
+    for (int i = 0; i < steps; ++i) {
+        long long delta = replica.mutation->propose(replica.solution);
+        if (delta > 0 && replica.gen.uniform() >= std::exp(-delta / replica.temp)) {
+            continue;
+        }
+        replica.mutation->apply(replica.solution);
+        replica.cur_loss += delta;
+        if (replica.cur_loss < replica.best_loss) {
+            replica.best_loss = replica.cur_loss;
+            replica.best_synced = false;
+            replica.mutation->clear_journal();
+        } else if (replica.best_synced) {
+            replica.mutation->clear_journal();
+        } else if (replica.mutation->journal_size() > CONFIG::MAX_JOURNAL_SIZE) {
+            sync_best(replica);
+        }
+    }
+}
+
+template <class Solution, class Mutation>
+void BasicReplicaExchangeAnnealing<Solution, Mutation>::sync_best(Replica& replica) {
+    if (!replica.best_synced) {
+        *replica.best_solution = *replica.solution;
+        replica.mutation->rollback(replica.best_solution);
+        replica.best_synced = true;
+    }
+    replica.mutation->clear_journal();
+}
+
+template <class Solution, class Mutation>
+void BasicReplicaExchangeAnnealing<Solution, Mutation>::exchange() {
+    // Чередуем чётные и нечётные пары, чтобы за два обмена
+    // решение могло сдвинуться по лестнице в любую сторону.
+    for (int i = exchanges % 2; i + 1 < int(ladder.size()); i += 2) {
+        Replica& cold = replicas[ladder[i]];
+        Replica& hot = replicas[ladder[i + 1]];
+        double log_p = (cold.cur_loss - hot.cur_loss) * (1 / cold.temp - 1 / hot.temp);
+        ++swap_attempts[i];
+        if (log_p >= 0 || gen.uniform() < std::exp(log_p)) {
+            ++swap_accepts[i];
+            std::swap(cold.temp, hot.temp);
+            std::swap(ladder[i], ladder[i + 1]);
+        }
+    }
+    ++exchanges;
+}
+
+template <class Solution, class Mutation>
+void BasicReplicaExchangeAnnealing<Solution, Mutation>::simulate_annealing(double seconds) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    std::function<void(int)> sweep = [&](int i) {
+        run_replica(replicas[i], CONFIG::REPLICA_EXCHANGE_INTERVAL);
+    };
+    while (std::chrono::steady_clock::now() < deadline) {
+        pool.run(sweep);
+        exchange();
+        long long best_loss = smallest_loss;
+        for (const Replica& replica : replicas) {
+            best_loss = std::min(best_loss, replica.best_loss);
+        }
+        if (optimality_gap_reached(best_loss, lower_bound)) {
+            break;
+        }
+    }
+
+    Replica* best_replica = nullptr;
+    for (Replica& replica : replicas) {
+        if (replica.best_loss < smallest_loss) {
+            smallest_loss = replica.best_loss;
+            best_replica = &replica;
+        }
+    }
+    if (best_replica != nullptr) {
+        sync_best(*best_replica);
+        *best_solution = *best_replica->best_solution;
+    }
+}
+
+template <class Solution, class Mutation>
+void BasicReplicaExchangeAnnealing<Solution, Mutation>::print_swap_rates() const {
+    for (std::size_t i = 0; i + 1 < temperatures.size(); ++i) {
+        double rate = swap_attempts[i] ? double(swap_accepts[i]) / swap_attempts[i] : 0;
+        std::cout << std::fixed << std::setprecision(2)
+                  << temperatures[i] << " <-> " << temperatures[i + 1] << ": "
+                  << swap_accepts[i] << '/' << swap_attempts[i]
+                  << " (" << rate << ")\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+template <class Solution, class Mutation>
+BasicReplicaExchangeAnnealing<Solution, Mutation>::~BasicReplicaExchangeAnnealing() {
+    for (Replica& replica : replicas) {
+        delete replica.solution;
+        delete replica.best_solution;
+        delete replica.mutation;
+    }
+    delete best_solution;
+}
+
+
+
+template <class Solution, class Mutation, class Law>
+BasicIslandAnnealing<Solution, Mutation, Law>::BasicIslandAnnealing(const Solution& solution
+        , const Mutation& mutation
+        , Law& temperature_decrease_law
+        , double start_temp
+        , int island_count
+        , MigrationTopology topology
+        , std::uint64_t seed):
+        board(island_count)
+        , islands(island_count)
+        , topology(topology)
+        , temperature_decrease_law(temperature_decrease_law)
+        , start_temp(start_temp)
+        , seed(seed)
+        , best_solution(solution.clone())
+        , smallest_loss(solution.get_loss_metric())
+        , lower_bound(solution.get_loss_lower_bound())
+        , pool(island_count) {
+    pool.run([&](int i) {
+        Island& island = islands[i];
+        island.solution = solution.clone();
+        island.best_solution = solution.clone();
+        island.migrant = solution.clone();
+        island.mutation = mutation.clone();
+        island.best_loss = smallest_loss;
+        board[i].solution = solution.clone();
+        board[i].loss = smallest_loss;
+    });
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicIslandAnnealing<Solution, Mutation, Law>::publish(int i, Engine& sim) {
+    Slot& slot = board[i];
+    if (!slot.m.try_lock()) {
+        return;
+    }
+    *slot.solution = *sim.get_solution();
+    slot.loss.store(sim.get_best_loss(), std::memory_order_relaxed);
+    slot.version.fetch_add(1, std::memory_order_release);
+    slot.m.unlock();
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicIslandAnnealing<Solution, Mutation, Law>::pull(int i, Engine& sim
+                                                         , std::vector<std::uint64_t>& seen) {
+    int n = board.size();
+    int source = (i + n - 1) % n;
+    if (topology == MigrationTopology::BROADCAST) {
+        for (int j = 0; j < n; ++j) {
+            if (board[j].loss.load(std::memory_order_relaxed)
+                    < board[source].loss.load(std::memory_order_relaxed)) {
+                source = j;
+            }
+        }
+    }
+    Slot& slot = board[source];
+    if (source == i || slot.version.load(std::memory_order_acquire) == seen[source]
+            || slot.loss.load(std::memory_order_relaxed) >= sim.get_best_loss()
+            || !slot.m.try_lock()) {
+        return;
+    }
+    *islands[i].migrant = *slot.solution;
+    seen[source] = slot.version.load(std::memory_order_relaxed);
+    slot.m.unlock();
+    sim.migrate(*islands[i].migrant);
+    ++islands[i].migrations;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicIslandAnnealing<Solution, Mutation, Law>::run_island(int i
+        , std::chrono::steady_clock::time_point deadline) {
+    Island& island = islands[i];
+    std::vector<std::uint64_t> seen(board.size(), 0);
+    while (!done.load(std::memory_order_relaxed)) {
+        Engine sim(island.solution, island.best_solution, *island.mutation
+                   , temperature_decrease_law, start_temp);
+        // Свои потоки генератора на каждый остров и каждый перезапуск.
+        sim.seed(seed + island.restarts, i);
+        sim.begin();
+        ++island.restarts;
+        long long published = sim.get_best_loss();
+        bool running = true;
+        ScopedProbe probe(Probe::RUN);
+        while (running) {
+            for (int s = 0; running && s < CONFIG::MIGRATION_INTERVAL; ++s) {
+                running = sim.step();
+            }
+            if (optimality_gap_reached(sim.get_best_loss(), lower_bound)
+                    || std::chrono::steady_clock::now() >= deadline) {
+                done.store(true, std::memory_order_relaxed);
+            }
+            if (done.load(std::memory_order_relaxed)) {
+                break;
+            }
+            if (sim.get_best_loss() < published) {
+                publish(i, sim);
+                published = sim.get_best_loss();
+            }
+            pull(i, sim, seen);
+        }
+        // Следующий отжиг острова начинается с его лучшего решения.
+        *island.solution = *sim.get_solution();
+        island.best_loss = sim.get_best_loss();
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicIslandAnnealing<Solution, Mutation, Law>::simulate_annealing(double seconds) {
+    auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    done = false;
+    std::function<void(int)> island_job = [&](int i) {
+        run_island(i, deadline);
+    };
+    pool.run(island_job);
+
+    const Island* best_island = nullptr;
+    for (const Island& island : islands) {
+        if (island.best_loss < smallest_loss) {
+            smallest_loss = island.best_loss;
+            best_island = &island;
+        }
+    }
+    if (best_island != nullptr) {
+        *best_solution = *best_island->best_solution;
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+BasicIslandAnnealing<Solution, Mutation, Law>::~BasicIslandAnnealing() {
+    for (Island& island : islands) {
+        delete island.solution;
+        delete island.best_solution;
+        delete island.migrant;
+        delete island.mutation;
+    }
+    for (Slot& slot : board) {
+        delete slot.solution;
+    }
+    delete best_solution;
+}
+
+
+
+template <class Solution, class Mutation, class Law>
+BasicRacingAnnealing<Solution, Mutation, Law>::BasicRacingAnnealing(const Solution& solution
+        , const Mutation& mutation
+        , Law& temperature_decrease_law
+        , double start_temp
+        , int chains
+        , int threads
+        , std::uint64_t seed):
+        racers(chains)
+        , temperature_decrease_law(temperature_decrease_law)
+        , start_temp(start_temp)
+        , seed(seed)
+        , best_solution(solution.clone())
+        , smallest_loss(solution.get_loss_metric())
+        , lower_bound(solution.get_loss_lower_bound())
+        , pool(std::min(threads, chains)) {
+    // Буферы цепочки создаются в потоке, который будет её считать.
+    pool.run([&](int t) {
+        for (int c = t; c < int(racers.size()); c += pool.size()) {
+            Racer& racer = racers[c];
+            racer.solution = solution.clone();
+            racer.best_solution = solution.clone();
+            racer.mutation = mutation.clone();
+            racer.sim = new Engine(racer.solution, racer.best_solution, *racer.mutation
+                                   , temperature_decrease_law, start_temp);
+            racer.sim->seed(seed, c);
+            racer.sim->begin();
+        }
+    });
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicRacingAnnealing<Solution, Mutation, Law>::cull() {
+    std::vector<int> order(racers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        if (racers[a].running != racers[b].running) {
+            return racers[a].running;
+        }
+        return racers[a].sim->get_best_loss() < racers[b].sim->get_best_loss();
+    });
+    int live = std::count_if(racers.begin(), racers.end(), [](const Racer& racer) {
+        return racer.running;
+    });
+    int survivors = (live + 1) / 2;
+    for (int j = survivors; j < int(order.size()); ++j) {
+        Racer& loser = racers[order[j]];
+        Racer& winner = racers[order[(j - survivors) % survivors]];
+        loser.sim->adopt(*winner.sim);
+        // Новые потоки генератора - через зерно: номер потока стоит jump()
+        // на каждую единицу, а копий за прогон тысячи.
+        loser.sim->seed(seed + rounds, order[j]);
+        loser.running = true;
+        ++clones;
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicRacingAnnealing<Solution, Mutation, Law>::restart() {
+    pool.run([&](int t) {
+        for (int c = t; c < int(racers.size()); c += pool.size()) {
+            Racer& racer = racers[c];
+            delete racer.sim;
+            *racer.solution = *best_solution;
+            racer.sim = new Engine(racer.solution, racer.best_solution, *racer.mutation
+                                   , temperature_decrease_law, start_temp);
+            racer.sim->seed(seed + rounds, c);
+            racer.sim->begin();
+            racer.running = true;
+        }
+    });
+    ++legs;
+}
+
+template <class Solution, class Mutation, class Law>
+void BasicRacingAnnealing<Solution, Mutation, Law>::simulate_annealing(long long budget) {
+    long long spent = 0;
+    long long interval = 0;
+    long long leg_best = smallest_loss;
+    int legs_without_improvement = 0;
+    std::function<void(int)> race_job = [&](int t) {
+        for (int c = t; c < int(racers.size()); c += pool.size()) {
+            Racer& racer = racers[c];
+            racer.steps = 0;
+            ScopedProbe probe(Probe::RUN);
+            while (racer.running && racer.steps < interval) {
+                racer.running = racer.sim->step();
+                ++racer.steps;
+            }
+        }
+    };
+    while (spent < budget) {
+        // Последний раунд укорачивается, чтобы не выйти за бюджет.
+        long long chains = racers.size();
+        interval = std::min<long long>(CONFIG::RACE_INTERVAL, (budget - spent + chains - 1) / chains);
+        pool.run(race_job);
+        ++rounds;
+        bool any_running = false;
+        for (Racer& racer : racers) {
+            spent += racer.steps;
+            any_running |= racer.running;
+            // Лучшее решение забирается сразу: на отсеве цепочку могут перезаписать.
+            if (racer.sim->get_best_loss() < smallest_loss) {
+                smallest_loss = racer.sim->get_best_loss();
+                *best_solution = *racer.sim->get_solution();
+            }
+        }
+        if (optimality_gap_reached(smallest_loss, lower_bound)) {
+            break;
+        }
+        if (any_running) {
+            cull();
+            continue;
+        }
+        if (smallest_loss < leg_best) {
+            leg_best = smallest_loss;
+            legs_without_improvement = 0;
+        } else if (++legs_without_improvement >= CONFIG::MAX_ROUNDS_WITHOUT_IMPROVEMENT) {
+            break;
+        }
+        restart();
+    }
+}
+
+template <class Solution, class Mutation, class Law>
+BasicRacingAnnealing<Solution, Mutation, Law>::~BasicRacingAnnealing() {
+    for (Racer& racer : racers) {
+        delete racer.sim;
+        delete racer.solution;
+        delete racer.best_solution;
+        delete racer.mutation;
+    }
+    delete best_solution;
+}
+
+#endif // SRC_PARALLEL_H_
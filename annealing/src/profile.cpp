@@ -0,0 +1,183 @@
+#include "profile.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+    const char* PROBE_NAMES[int(Probe::PROBES)] = {
+        "run", "propose", "accept", "apply", "replace", "best_sync", "temperature"
+    };
+
+    // Верхняя граница корзины, в которую попадает доля quantile замеров.
+    std::uint64_t quantile_ticks(const std::uint64_t* buckets, std::uint64_t count, double quantile) {
+        std::uint64_t rank = std::uint64_t(quantile * (count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < ProbeHistogram::BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                return b + 1 < 64 ? (std::uint64_t(1) << (b + 1)) - 1 : ~std::uint64_t(0);
+            }
+        }
+        return 0;
+    }
+
+    // Наименьшее время пустой пробы: два чтения счётчика подряд. Столько
+    // же в каждом замере приходится на саму пробу.
+    std::uint64_t empty_probe_ticks() {
+        std::uint64_t best = ~std::uint64_t(0);
+        for (int i = 0; i < 64; ++i) {
+            std::uint64_t start = probe_ticks();
+            best = std::min(best, probe_ticks() - start);
+        }
+        return best;
+    }
+
+    std::mutex dump_mutex;
+
+    // Гистограммы живых потоков и сумма гистограмм завершившихся.
+    struct Registry {
+        std::mutex m;
+        std::vector<ProbeHistogram*> live;
+        ProbeHistogram retired;
+        bool any_retired = false;
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+}
+
+
+ProbeHistogram::Enrolled::Enrolled() {
+    Registry& r = registry();
+    std::lock_guard lock(r.m);
+    r.live.push_back(&histogram);
+}
+
+ProbeHistogram::Enrolled::~Enrolled() {
+    Registry& r = registry();
+    std::lock_guard lock(r.m);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), &histogram));
+    if (histogram.empty()) {
+        return;
+    }
+    if (r.any_retired) {
+        r.retired.merge(histogram);
+    } else {
+        r.retired = histogram;
+        r.any_retired = true;
+    }
+}
+
+ProbeHistogram ProbeHistogram::total() {
+    Registry& r = registry();
+    std::lock_guard lock(r.m);
+    ProbeHistogram sum;
+    bool first = true;
+    auto add = [&](const ProbeHistogram& histogram) {
+        if (first) {
+            sum = histogram;
+            first = false;
+        } else {
+            sum.merge(histogram);
+        }
+    };
+    // Потоки без замеров (простаивавшие с обнуления) в сводку не входят.
+    for (const ProbeHistogram* histogram : r.live) {
+        if (!histogram->empty()) {
+            add(*histogram);
+        }
+    }
+    if (r.any_retired) {
+        add(r.retired);
+    }
+    return sum;
+}
+
+void ProbeHistogram::reset_all() {
+    Registry& r = registry();
+    std::lock_guard lock(r.m);
+    for (ProbeHistogram* histogram : r.live) {
+        histogram->reset();
+    }
+    r.any_retired = false;
+}
+
+
+void ProbeHistogram::reset() {
+    std::memset(entries, 0, sizeof(entries));
+    origin_ticks = probe_ticks();
+    origin_time = std::chrono::steady_clock::now();
+}
+
+bool ProbeHistogram::empty() const {
+    return std::all_of(std::begin(entries), std::end(entries), [](const Entry& entry) {
+        return entry.count == 0;
+    });
+}
+
+void ProbeHistogram::merge(const ProbeHistogram& other) {
+    for (int p = 0; p < int(Probe::PROBES); ++p) {
+        entries[p].count += other.entries[p].count;
+        entries[p].ticks += other.entries[p].ticks;
+        for (int b = 0; b < BUCKETS; ++b) {
+            entries[p].buckets[b] += other.entries[p].buckets[b];
+        }
+    }
+    // Такты переводятся по самому долгому отрезку часов.
+    if (other.origin_time < origin_time) {
+        origin_ticks = other.origin_ticks;
+        origin_time = other.origin_time;
+    }
+    threads += other.threads;
+}
+
+void ProbeHistogram::dump(std::ostream& out) const {
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - origin_time;
+    std::uint64_t ticks = probe_ticks() - origin_ticks;
+    double ns_per_tick = ticks > 0 ? elapsed.count() / ticks : 1;
+    double run_ticks = entries[int(Probe::RUN)].ticks;
+
+    std::ostringstream table;
+    table << "profile of " << threads << (threads == 1 ? " thread" : " threads") << " (" << ns_per_tick
+          << " ns per tick, empty probe " << empty_probe_ticks() * ns_per_tick
+          << " ns, times inclusive):\n";
+    table << std::left << std::setw(12) << "probe" << std::right
+          << std::setw(12) << "count" << std::setw(12) << "total ms" << std::setw(8) << "% run"
+          << std::setw(14) << "mean ns" << std::setw(14) << "p50 ns" << std::setw(14) << "p99 ns" << '\n';
+    table << std::fixed;
+    for (int p = 0; p < int(Probe::PROBES); ++p) {
+        const Entry& entry = entries[p];
+        if (entry.count == 0) {
+            continue;
+        }
+        table << std::left << std::setw(12) << PROBE_NAMES[p] << std::right
+              << std::setw(12) << entry.count
+              << std::setw(12) << std::setprecision(3) << entry.ticks * ns_per_tick / 1e6
+              << std::setw(8) << std::setprecision(1) << (run_ticks > 0 ? 100 * entry.ticks / run_ticks : 0)
+              << std::setw(14) << std::setprecision(1) << entry.ticks * ns_per_tick / entry.count
+              << std::setw(14) << std::setprecision(0)
+              << quantile_ticks(entry.buckets, entry.count, 0.5) * ns_per_tick
+              << std::setw(14) << quantile_ticks(entry.buckets, entry.count, 0.99) * ns_per_tick << '\n';
+    }
+
+    std::lock_guard lock(dump_mutex);
+    out << table.str() << std::flush;
+}
+
+ProfileReport::ProfileReport() {
+    if constexpr (ProbeHistogram::ENABLED) {
+        ProbeHistogram::reset_all();
+    }
+}
+
+ProfileReport::~ProfileReport() {
+    if constexpr (ProbeHistogram::ENABLED) {
+        ProbeHistogram::total().dump(std::cerr);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef SRC_PROFILE_H_
+#define SRC_PROFILE_H_
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Пробы горячего пути выключены по умолчанию: с -DANNEALING_PROFILE=1
+// BasicSimulateAnnealing замеряет свои фазы счётчиком тактов, а программа
+// в конце печатает в stderr сводку всех потоков (ProfileReport). Без флага
+// ScopedProbe - пустой класс, и в цикле отжига от проб не остаётся ни
+// одной инструкции.
+#ifndef ANNEALING_PROFILE
+#define ANNEALING_PROFILE 0
+#endif
+
+// Что замеряется. Времена включающие: BEST_SYNC бывает внутри REPLACE,
+// а все пробы - внутри RUN, поэтому доли считаются от RUN.
+enum class Probe {
+    RUN,          // весь simulate_annealing или цепочка острова, заезд гонки
+    PROPOSE,      // выбор хода и изменение метрики (propose, блок, спекуляция)
+    ACCEPT,       // критерий Метрополиса для ухудшающего хода: генератор и exp
+    APPLY,        // применение принятого хода к решению
+    REPLACE,      // replace_solution: журнал отката и учёт лучшего решения
+    BEST_SYNC,    // копирование лучшего решения
+    TEMPERATURE,  // закон понижения температуры
+    PROBES
+};
+
+// Такты процессора (rdtsc) на x86, иначе наносекунды CLOCK_MONOTONIC.
+inline std::uint64_t probe_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return std::uint64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+}
+
+// Гистограммы длительностей проб одного потока: число замеров, сумма
+// и корзины по степеням двойки в тактах. Потоки пишут каждый в свою
+// гистограмму без синхронизации; такты переводятся в наносекунды при
+// печати по часам, прошедшим с обнуления. Гистограммы потоков учитываются
+// в общем списке, гистограмма завершившегося потока прибавляется к сводке
+// завершившихся.
+class ProbeHistogram {
+public:
+    static constexpr bool ENABLED = ANNEALING_PROFILE;
+    static constexpr int BUCKETS = 64;
+
+private:
+    struct Entry {
+        std::uint64_t count;
+        std::uint64_t ticks;
+        std::uint64_t buckets[BUCKETS];
+    };
+
+    Entry entries[int(Probe::PROBES)];
+    std::uint64_t origin_ticks;
+    std::chrono::steady_clock::time_point origin_time;
+    int threads = 1;
+
+    struct Enrolled;
+
+public:
+    ProbeHistogram() {reset();}
+
+    // Гистограмма вызывающего потока.
+    static ProbeHistogram& local();
+
+    // Сводка по всем потокам процесса, живым и завершившимся, и её
+    // обнуление. Чужие гистограммы читаются без синхронизации, поэтому
+    // звать, только когда измеряемые потоки стоят: после ThreadPool::run,
+    // join или между запросами.
+    static ProbeHistogram total();
+    static void reset_all();
+
+    void add(Probe probe, std::uint64_t ticks) {
+        Entry& entry = entries[int(probe)];
+        ++entry.count;
+        entry.ticks += ticks;
+        ++entry.buckets[ticks == 0 ? 0 : 63 - __builtin_clzll(ticks)];
+    }
+
+    std::uint64_t count(Probe probe) const {return entries[int(probe)].count;}
+    void reset();
+    bool empty() const;
+    void merge(const ProbeHistogram&);
+    // Таблица по пробам: число замеров, суммарное время и доля от RUN,
+    // среднее и верхние границы корзин медианы и 99-го процентиля.
+    // Пишется одним куском, чтобы сводки разных потоков не перемешались.
+    void dump(std::ostream&) const;
+};
+
+// Гистограмма потока, записанная в общий список на время жизни потока.
+struct ProbeHistogram::Enrolled {
+    ProbeHistogram histogram;
+    Enrolled();
+    ~Enrolled();
+};
+
+inline ProbeHistogram& ProbeHistogram::local() {
+    thread_local Enrolled enrolled;
+    return enrolled.histogram;
+}
+
+// Сводка проб за время жизни объекта: конструктор обнуляет гистограммы
+// всех потоков, деструктор печатает их сумму в stderr. Ставится в main
+// программы вокруг прогонов; без ANNEALING_PROFILE ничего не делает.
+class ProfileReport {
+public:
+    ProfileReport();
+    ProfileReport(const ProfileReport&) = delete;
+    ProfileReport& operator=(const ProfileReport&) = delete;
+    ~ProfileReport();
+};
+
+#if ANNEALING_PROFILE
+// Прибавляет время жизни объекта к пробе в гистограмме своего потока.
+class ScopedProbe {
+    ProbeHistogram& histogram;
+    Probe probe;
+    std::uint64_t start;
+
+public:
+    explicit ScopedProbe(Probe probe): histogram(ProbeHistogram::local())
+            , probe(probe)
+            , start(probe_ticks()) {}
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+    ~ScopedProbe() {histogram.add(probe, probe_ticks() - start);}
+};
+#else
+class ScopedProbe {
+public:
+    explicit ScopedProbe(Probe) {}
+};
+#endif
+
+#endif // SRC_PROFILE_H_
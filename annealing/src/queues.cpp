@@ -0,0 +1,105 @@
+#include "queues.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    // Запас очереди, переехавшей в хвост, - четверть длины: с большим
+    // запасом хвост кончается быстрее и compact вызывается чаще.
+    std::size_t grown_capacity(std::size_t need) {
+        return need + need / 4 + 8;
+    }
+
+    // Запас после переупаковки и копирования решения.
+    std::size_t packed_capacity(std::size_t length) {
+        return length + length / 16 + 8;
+    }
+}
+
+
+void QueueArena::reset(int k, std::size_t n) {
+    std::size_t size = n + n / 4 + 16 * std::size_t(k);
+    if (size > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Too many works for 32-bit queue indices");
+    }
+    slots.resize(size);
+    segments.assign(k, Segment{0, 0});
+    lengths.assign(k, 0);
+    order.resize(k);
+    used = 0;
+}
+
+std::int32_t* QueueArena::extend(int q, std::size_t count) {
+    if (lengths[q] + count > segments[q].capacity) {
+        grow(q, lengths[q] + count);
+    }
+    std::int32_t* tail = data(q) + lengths[q];
+    lengths[q] += count;
+    return tail;
+}
+
+void QueueArena::grow(int q, std::size_t need) {
+    Segment& segment = segments[q];
+    std::size_t capacity = grown_capacity(need);
+    if (segment.start + segment.capacity == used && segment.start + capacity <= slots.size()) {
+        segment.capacity = capacity;
+        used = segment.start + capacity;
+        return;
+    }
+    if (used + capacity > slots.size()) {
+        compact(q, need);
+        return;
+    }
+    std::memcpy(slots.data() + used, slots.data() + segment.start, lengths[q] * sizeof(std::int32_t));
+    segment.start = used;
+    segment.capacity = capacity;
+    used += capacity;
+}
+
+void QueueArena::compact(int q, std::size_t need) {
+    std::size_t total = 0;
+    for (int i = 0; i < count(); ++i) {
+        total += packed_capacity(i == q ? need : lengths[i]);
+    }
+    if (total > slots.size()) {
+        throw std::runtime_error("Queue arena overflow");
+    }
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::int32_t a, std::int32_t b) {
+        return segments[a].start < segments[b].start;
+    });
+
+    // Сначала вплотную влево в порядке отрезков: очередь сдвигается
+    // не дальше начала своего отрезка и не задевает ещё не сдвинутые.
+    std::size_t cursor = 0;
+    for (std::int32_t i : order) {
+        std::memmove(slots.data() + cursor, data(i), lengths[i] * sizeof(std::int32_t));
+        segments[i].start = cursor;
+        cursor += lengths[i];
+    }
+    // Затем вправо на итоговые места с запасом, начиная с последней.
+    std::size_t end = total;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        std::int32_t i = *it;
+        std::size_t capacity = packed_capacity(i == q ? need : lengths[i]);
+        end -= capacity;
+        std::memmove(slots.data() + end, data(i), lengths[i] * sizeof(std::int32_t));
+        segments[i] = {std::uint32_t(end), std::uint32_t(capacity)};
+    }
+    used = total;
+}
+
+void QueueArena::copy_from(const QueueArena& other) {
+    slots.resize(other.slots.size());
+    segments.resize(other.count());
+    lengths = other.lengths;
+    order.resize(other.count());
+    used = 0;
+    for (int i = 0; i < count(); ++i) {
+        std::size_t capacity = packed_capacity(lengths[i]);
+        segments[i] = {std::uint32_t(used), std::uint32_t(capacity)};
+        std::memcpy(slots.data() + used, other.data(i), lengths[i] * sizeof(std::int32_t));
+        used += capacity;
+    }
+}
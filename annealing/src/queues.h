@@ -0,0 +1,96 @@
+#ifndef SRC_QUEUES_H_
+#define SRC_QUEUES_H_
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Очереди процессоров в одном массиве slots. Очередь q занимает отрезок
+// [start, start + capacity) массива, её работы лежат в начале отрезка.
+// Переполненная очередь растёт на месте, если её отрезок последний,
+// иначе переезжает в свободный хвост массива. Когда хвост кончается,
+// compact переупаковывает все очереди подряд с небольшим запасом.
+// Массив рассчитан на n работ во всех очередях вместе, его размер
+// n + n / 4 + 16 k не меняется до следующего reset, так что память
+// решения известна заранее и после прогрева не выделяется.
+//
+// Номера работ и границы отрезков 32-битные: очереди вмещают до 2^31 работ.
+class QueueArena {
+    struct Segment {
+        std::uint32_t start;
+        std::uint32_t capacity;
+    };
+
+    std::vector<std::int32_t> slots;
+    std::vector<Segment> segments;
+    std::vector<std::int32_t> lengths;
+    // Порядок очередей по началу отрезка для compact, выделен заранее.
+    std::vector<std::int32_t> order;
+    // Начало свободного хвоста slots.
+    std::size_t used = 0;
+
+    // Освобождает в очереди q место хотя бы под need работ.
+    void grow(int q, std::size_t need);
+    // Переупаковывает очереди подряд; очереди q - место под need работ.
+    void compact(int q, std::size_t need);
+    // Раскладывает очереди other подряд в slots.
+    void copy_from(const QueueArena& other);
+
+public:
+    QueueArena() = default;
+    QueueArena(const QueueArena& other) {copy_from(other);}
+    QueueArena& operator=(const QueueArena& other) {
+        if (this != &other) {
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    // k пустых очередей под n работ; выделенная память переиспользуется.
+    void reset(int k, std::size_t n);
+
+    int count() const {return segments.size();}
+    std::int32_t size(int q) const {return lengths[q];}
+    bool empty(int q) const {return lengths[q] == 0;}
+    // Длины всех очередей подряд, для векторной оценки ходов.
+    const std::int32_t* sizes() const {return lengths.data();}
+    // Указатели на работы очереди действительны до следующего изменения длины
+    // какой-нибудь очереди: при росте очереди переезжают.
+    std::int32_t* data(int q) {return slots.data() + segments[q].start;}
+    const std::int32_t* data(int q) const {return slots.data() + segments[q].start;}
+    std::int32_t back(int q) const {return data(q)[lengths[q] - 1];}
+
+    void push_back(int q, std::int32_t work) {
+        if (std::uint32_t(lengths[q]) == segments[q].capacity) {
+            grow(q, lengths[q] + 1);
+        }
+        data(q)[lengths[q]++] = work;
+    }
+    void pop_back(int q) {--lengths[q];}
+    // Дописывает count работ в конец очереди и возвращает указатель на них.
+    std::int32_t* extend(int q, std::size_t count);
+    void insert(int q, int position, std::int32_t work) {
+        if (std::uint32_t(lengths[q]) == segments[q].capacity) {
+            grow(q, lengths[q] + 1);
+        }
+        std::int32_t* queue = data(q);
+        std::memmove(queue + position + 1, queue + position
+                     , (lengths[q] - position) * sizeof(std::int32_t));
+        queue[position] = work;
+        ++lengths[q];
+    }
+    void erase(int q, int position) {
+        std::int32_t* queue = data(q);
+        std::memmove(queue + position, queue + position + 1
+                     , (lengths[q] - position - 1) * sizeof(std::int32_t));
+        --lengths[q];
+    }
+
+    // Байт кучи под массив и описания очередей.
+    std::size_t memory_usage() const {
+        return slots.capacity() * sizeof(std::int32_t) + segments.capacity() * sizeof(Segment)
+               + (lengths.capacity() + order.capacity()) * sizeof(std::int32_t);
+    }
+};
+
+#endif // SRC_QUEUES_H_
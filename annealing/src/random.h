@@ -0,0 +1,129 @@
+#ifndef SRC_RANDOM_H_
+#define SRC_RANDOM_H_
+#include <array>
+#include <cstdint>
+#include <random>
+
+// xoshiro256** (Blackman, Vigna): 256 бит состояния, несколько тактов на число.
+// Удовлетворяет UniformRandomBitGenerator, так что подходит и для <random>.
+// Независимые потоки для цепочек и потоков получаются через jump():
+// каждый прыжок сдвигает последовательность на 2^128 чисел.
+class Xoshiro256 {
+public:
+    using result_type = std::uint64_t;
+    using State = std::array<std::uint64_t, 4>;
+
+private:
+    State s;
+
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    static constexpr result_type min() {return 0;}
+    static constexpr result_type max() {return UINT64_MAX;}
+
+    explicit Xoshiro256(std::uint64_t seed_value = 0, std::uint64_t stream = 0) {
+        seed(seed_value, stream);
+    }
+
+    // Состояние заполняется через splitmix64, затем делается stream прыжков.
+    void seed(std::uint64_t seed_value, std::uint64_t stream = 0) {
+        for (std::uint64_t& word : s) {
+            seed_value += 0x9e3779b97f4a7c15;
+            std::uint64_t z = seed_value;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            word = z ^ (z >> 31);
+        }
+        for (std::uint64_t i = 0; i < stream; ++i) {
+            jump();
+        }
+    }
+
+    result_type operator()() {
+        std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    void jump() {
+        static constexpr std::uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                                 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+        State t{};
+        for (std::uint64_t mask : JUMP) {
+            for (int b = 0; b < 64; ++b) {
+                if (mask & (std::uint64_t(1) << b)) {
+                    for (int i = 0; i < 4; ++i) {
+                        t[i] ^= s[i];
+                    }
+                }
+                (*this)();
+            }
+        }
+        s = t;
+    }
+
+    // Целое из [0, bound) умножением старших 32 бит (Lemire) без деления.
+    // Смещение не больше bound / 2^32, для индексов работ и процессоров это неважно.
+    std::uint32_t below(std::uint32_t bound) {
+        return ((*this)() >> 32) * bound >> 32;
+    }
+
+    // Равномерное double из [0, 1) по старшим 53 битам.
+    double uniform() {
+        return ((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Пакетные версии: один проход без ветвлений по массиву.
+    void fill_below(std::uint32_t* out, int count, std::uint32_t bound) {
+        for (int i = 0; i < count; ++i) {
+            out[i] = below(bound);
+        }
+    }
+
+    void fill_uniform(double* out, int count) {
+        for (int i = 0; i < count; ++i) {
+            out[i] = uniform();
+        }
+    }
+
+    const State& state() const {return s;}
+    void set_state(const State& state) {s = state;}
+};
+
+// Блок заранее сгенерированных чисел. fill(T* out, int count) вызывается,
+// когда блок исчерпан, и заполняет его целиком, а в горячем цикле остаётся
+// чтение из массива.
+template <class T, int N = 64>
+class RandomBlock {
+    std::array<T, N> values;
+    int pos = N;
+
+public:
+    template <class Fill>
+    T next(Fill&& fill) {
+        if (pos == N) {
+            fill(values.data(), N);
+            pos = 0;
+        }
+        return values[pos++];
+    }
+
+    void reset() {pos = N;}
+};
+
+// Случайное зерно для запусков без явного --seed.
+inline std::uint64_t random_seed() {
+    std::random_device rd;
+    return (std::uint64_t(rd()) << 32) ^ rd();
+}
+
+#endif // SRC_RANDOM_H_
@@ -0,0 +1,289 @@
+#include "service.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    SolveResponse make_response(std::uint64_t id, SolveResponse::Kind kind) {
+        SolveResponse response{};
+        std::memcpy(response.magic, SolverService::RESPONSE_MAGIC, sizeof(response.magic));
+        response.id = id;
+        response.kind = kind;
+        return response;
+    }
+
+    bool send_all(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+}
+
+
+SolverService::Connection::~Connection() {
+    close(fd);
+}
+
+void SolverService::Connection::send(const SolveResponse& response, const char* frame) {
+    std::lock_guard lock(write_lock);
+    if (broken) {
+        return;
+    }
+    broken = !send_all(fd, reinterpret_cast<const char*>(&response), sizeof(response))
+             || (frame != nullptr && !send_all(fd, frame, response.frame_size));
+}
+
+
+SolverService::SolverService(int threads): wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+        , buffers(threads)
+        , pool(threads) {
+    if (wake_fd == -1) {
+        throw std::runtime_error("Can't create eventfd");
+    }
+}
+
+void SolverService::wake() {
+    std::uint64_t one = 1;
+    ssize_t written = write(wake_fd, &one, sizeof(one));
+    (void)written;
+}
+
+void SolverService::stop() {
+    shutdown.cancel();
+    wake();
+}
+
+void SolverService::solve(Buffers& worker, Job& job) {
+    const SolveRequest& request = job.request;
+    if (worker.solution == nullptr) {
+        worker.solution = new ImplAnnealingSolution(job.instance);
+        worker.best_solution = new ImplAnnealingSolution(*worker.solution);
+    }
+    worker.solution->reset(job.instance, INITS[request.init]);
+    *worker.best_solution = *worker.solution;
+
+    SolveResponse response = make_response(request.id, SolveResponse::RESULT);
+    visit_law(LAWS[request.law], [&](auto& law) {
+        BasicSimulateAnnealing sim(worker.solution, worker.best_solution, worker.mutation, law, 1000);
+        sim.seed(request.seed);
+        sim.set_cancellation(&shutdown);
+        if (request.deadline_ms > 0) {
+            sim.set_deadline(std::chrono::steady_clock::now()
+                             + std::chrono::milliseconds(request.deadline_ms));
+        }
+        if (request.progress_ms > 0) {
+            job.best = std::make_unique<BestSnapshot>(worker.solution->serialized_size());
+            sim.set_best_snapshot(job.best.get());
+            {
+                std::lock_guard lock(running_m);
+                running.push_back(&job);
+            }
+            wake();
+        }
+        sim.simulate_annealing();
+        if (request.progress_ms > 0) {
+            std::lock_guard lock(running_m);
+            running.erase(std::find(running.begin(), running.end(), &job));
+        }
+
+        const AnnealingTelemetry& telemetry = sim.get_telemetry();
+        response.stop_reason = sim.get_stop_reason();
+        response.loss = sim.get_best_loss();
+        response.lower_bound = job.instance->optimal_loss();
+        response.iterations = sim.get_iterations();
+        response.proposed = telemetry.get_counters().proposed;
+        response.accepted = telemetry.get_counters().accepted;
+        response.seconds = telemetry.get_phase_seconds(AnnealingTelemetry::RUN);
+        response.frame_size = worker.solution->serialized_size();
+        worker.frame.resize(response.frame_size);
+        sim.get_solution()->serialize(worker.frame.data());
+    });
+    job.connection->send(response, worker.frame.data());
+}
+
+void SolverService::abandon(Buffers& worker, Job& job) {
+    {
+        std::lock_guard lock(running_m);
+        auto it = std::find(running.begin(), running.end(), &job);
+        if (it != running.end()) {
+            running.erase(it);
+        }
+    }
+    // Решения потока могли остаться недостроенными: следующая задача
+    // создаст их заново.
+    delete worker.solution;
+    delete worker.best_solution;
+    worker.solution = nullptr;
+    worker.best_solution = nullptr;
+    job.connection->send(make_response(job.request.id, SolveResponse::ERROR));
+}
+
+bool SolverService::parse(const std::shared_ptr<Connection>& connection) {
+    std::vector<char>& input = connection->input;
+    std::size_t offset = 0;
+    bool valid = true;
+    while (input.size() - offset >= sizeof(SolveRequest)) {
+        SolveRequest request;
+        std::memcpy(&request, input.data() + offset, sizeof(request));
+        if (std::memcmp(request.magic, REQUEST_MAGIC, sizeof(REQUEST_MAGIC)) != 0
+                || request.n == 0 || request.n > MAX_WORKS || request.k == 0 || request.k > request.n
+                || request.law >= std::size(LAWS) || request.init >= std::size(INITS)) {
+            connection->send(make_response(request.id, SolveResponse::ERROR));
+            valid = false;
+            break;
+        }
+        std::size_t size = sizeof(request) + request.n * sizeof(std::int32_t);
+        if (input.size() - offset < size) {
+            break;
+        }
+        std::vector<std::int32_t> works(request.n);
+        std::memcpy(works.data(), input.data() + offset + sizeof(request)
+                    , request.n * sizeof(std::int32_t));
+        if (std::any_of(works.begin(), works.end(), [](std::int32_t work) {return work < 0;})) {
+            connection->send(make_response(request.id, SolveResponse::ERROR));
+            valid = false;
+            break;
+        }
+        offset += size;
+
+        Job* job = new Job();
+        job->request = request;
+        job->instance = std::make_shared<const Instance>(request.k, std::move(works));
+        job->connection = connection;
+        pool.submit([this, job](int id) {
+            if (!shutdown.cancelled()) {
+                try {
+                    solve(buffers[id], *job);
+                } catch (const std::exception&) {
+                    abandon(buffers[id], *job);
+                }
+            }
+            delete job;
+        });
+    }
+    input.erase(input.begin(), input.begin() + offset);
+    return valid;
+}
+
+int SolverService::send_progress() {
+    std::lock_guard lock(running_m);
+    if (running.empty()) {
+        return -1;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto wait = std::chrono::steady_clock::duration::max();
+    for (Job* job : running) {
+        if (now >= job->next_progress) {
+            long long loss = job->best->loss();
+            if (loss < job->sent_loss) {
+                SolveResponse response = make_response(job->request.id, SolveResponse::PROGRESS);
+                response.loss = loss;
+                job->connection->send(response);
+                job->sent_loss = loss;
+            }
+            job->next_progress = now + std::chrono::milliseconds(job->request.progress_ms);
+        }
+        wait = std::min(wait, job->next_progress - now);
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+}
+
+void SolverService::serve(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + socket_path);
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener == -1) {
+        throw std::runtime_error("Can't create socket");
+    }
+    unlink(socket_path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1
+            || listen(listener, SOMAXCONN) == -1) {
+        close(listener);
+        throw std::runtime_error("Can't listen on " + socket_path);
+    }
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wake_fd, &event);
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+    std::vector<char> chunk(1 << 16);
+    epoll_event events[64];
+    int timeout = -1;
+    while (!shutdown.cancelled()) {
+        int ready = epoll_wait(epoll, events, std::size(events), timeout);
+        if (ready == -1 && errno != EINTR) {
+            close(epoll);
+            close(listener);
+            throw std::runtime_error("epoll_wait failed");
+        }
+        for (int e = 0; e < ready; ++e) {
+            int fd = events[e].data.fd;
+            if (fd == listener) {
+                int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client != -1) {
+                    event.data.fd = client;
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event);
+                    connections.emplace(client, std::make_shared<Connection>(client));
+                }
+            } else if (fd == wake_fd) {
+                std::uint64_t count;
+                ssize_t got = read(wake_fd, &count, sizeof(count));
+                (void)got;
+            } else {
+                std::shared_ptr<Connection> connection = connections[fd];
+                ssize_t got = read(fd, chunk.data(), chunk.size());
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got > 0) {
+                    connection->input.insert(connection->input.end(), chunk.data(), chunk.data() + got);
+                }
+                // Соединение закрывается, когда его отпустит последняя задача.
+                if (got <= 0 || !parse(connection)) {
+                    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+                    connections.erase(fd);
+                }
+            }
+        }
+        timeout = send_progress();
+    }
+    close(epoll);
+    close(listener);
+    unlink(socket_path.c_str());
+}
+
+SolverService::~SolverService() {
+    // Оставшиеся задачи отменены и только освобождают память.
+    shutdown.cancel();
+    pool.wait();
+    for (Buffers& worker : buffers) {
+        delete worker.solution;
+        delete worker.best_solution;
+    }
+    close(wake_fd);
+}
@@ -0,0 +1,127 @@
+#ifndef SRC_SERVICE_H_
+#define SRC_SERVICE_H_
+#include "annealing.h"
+#include "parallel.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Протокол резидентного решателя (daemon.cpp) поверх потокового Unix-сокета.
+// Клиент шлёт запросы подряд, не дожидаясь ответов: SolveRequest, за ним
+// n длительностей int32. Ответы приходят по мере готовности в любом порядке
+// и помечены id запроса: PROGRESS - лучшая метрика по ходу прогона, если
+// запрошена, RESULT - итог с телеметрией, за ним кадр serialize решения
+// на frame_size байт. На испорченный запрос приходит ERROR, и соединение
+// закрывается; если ошибкой кончился сам прогон, ERROR приходит с id
+// запроса, а соединение остаётся открытым. Числа в порядке байт машины.
+struct SolveRequest {
+    char magic[8];
+    std::uint64_t id;
+    std::uint32_t k;
+    std::uint32_t law;          // индекс в SolverService::LAWS
+    std::uint64_t n;
+    std::uint64_t seed;
+    std::uint32_t init;         // индекс в SolverService::INITS
+    std::uint32_t deadline_ms;  // 0 - без срока
+    std::uint32_t progress_ms;  // 0 - без PROGRESS
+    std::uint32_t reserved;
+};
+static_assert(sizeof(SolveRequest) == 56);
+
+struct SolveResponse {
+    enum Kind : std::uint32_t {RESULT, PROGRESS, ERROR};
+
+    char magic[8];
+    std::uint64_t id;
+    std::uint32_t kind;
+    std::uint32_t stop_reason;  // BasicSimulateAnnealing::StopReason
+    std::int64_t loss;
+    std::int64_t lower_bound;
+    std::int64_t iterations;
+    std::int64_t proposed;
+    std::int64_t accepted;
+    double seconds;
+    std::uint64_t frame_size;
+};
+static_assert(sizeof(SolveResponse) == 80);
+
+// Отжиг за Unix-сокетом: запросы выполняются в WorkStealingPool. Решения,
+// буфер лучшего решения и мутация у потока пула одни на все задачи и только
+// переносятся на новый экземпляр, так что после прогрева запрос не выделяет
+// память под расписание.
+class SolverService {
+public:
+    static constexpr char REQUEST_MAGIC[8] = {'A', 'N', 'N', 'R', 'E', 'Q', '1', '\0'};
+    static constexpr char RESPONSE_MAGIC[8] = {'A', 'N', 'N', 'R', 'E', 'S', '1', '\0'};
+    static constexpr const char* LAWS[] = {"mixed", "boltzmann", "cauchy", "adaptive"};
+    static constexpr const char* INITS[] = {"single", "spt", "lpt", "greedy"};
+    // Запросы с большим числом работ отклоняются, как и запросы без работ,
+    // с процессорами сверх числа работ или с отрицательными длительностями.
+    static constexpr std::uint64_t MAX_WORKS = std::uint64_t(1) << 28;
+
+private:
+    struct Connection {
+        int fd;
+        std::mutex write_lock;
+        bool broken = false;
+        std::vector<char> input;
+
+        explicit Connection(int fd): fd(fd) {}
+        ~Connection();
+        // Весь ответ одним куском под write_lock; ошибки записи глушат
+        // соединение, задачи дорабатывают без ответа.
+        void send(const SolveResponse&, const char* frame = nullptr);
+    };
+
+    struct Job {
+        SolveRequest request;
+        std::shared_ptr<const Instance> instance;
+        std::shared_ptr<Connection> connection;
+        std::unique_ptr<BestSnapshot> best;
+        // Поля потока сокета для PROGRESS.
+        long long sent_loss = std::numeric_limits<long long>::max();
+        std::chrono::steady_clock::time_point next_progress;
+    };
+
+    struct alignas(64) Buffers {
+        ImplAnnealingSolution* solution = nullptr;
+        ImplAnnealingSolution* best_solution = nullptr;
+        ImplMutateSolution mutation;
+        std::vector<char> frame;
+    };
+
+    // Прогоны с PROGRESS; их обходит поток сокета.
+    std::mutex running_m;
+    std::vector<Job*> running;
+
+    CancellationToken shutdown;
+    int wake_fd;
+    std::vector<Buffers> buffers;
+    WorkStealingPool pool;
+
+    void solve(Buffers&, Job&);
+    // Ответ ERROR на задачу, прерванную исключением.
+    void abandon(Buffers&, Job&);
+    void wake();
+    // Разбирает накопленные байты соединения; false - запрос испорчен.
+    bool parse(const std::shared_ptr<Connection>&);
+    // Пауза epoll_wait до следующего PROGRESS, -1 - без ограничения.
+    int send_progress();
+
+public:
+    explicit SolverService(int threads);
+    SolverService(const SolverService&) = delete;
+    SolverService& operator=(const SolverService&) = delete;
+
+    // Принимает соединения на socket_path, пока не вызван stop().
+    // Ошибки сокета - std::runtime_error.
+    void serve(const std::string& socket_path);
+    // Прерывает serve и идущие прогоны; можно звать из обработчика сигнала.
+    void stop();
+
+    ~SolverService();
+};
+
+#endif // SRC_SERVICE_H_
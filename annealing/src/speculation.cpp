@@ -0,0 +1,69 @@
+#include "speculation.h"
+
+namespace {
+    // Столько пустых проверок подряд, прежде чем уступить процессор.
+    constexpr int SPINS_BEFORE_YIELD = 1 << 10;
+    // Столько проверок вместе с уступками, прежде чем уснуть до следующего
+    // раунда: простаивающая команда не должна занимать ядра.
+    constexpr int SPINS_BEFORE_PARK = 1 << 14;
+
+    void relax(int& spins) {
+        if (++spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+SpinTeam::SpinTeam(int size) {
+    for (int i = 1; i < size; ++i) {
+        threads.emplace_back(&SpinTeam::member_loop, this, i);
+    }
+}
+
+void SpinTeam::member_loop(int id) {
+    std::uint64_t seen = 0;
+    while (1) {
+        std::uint64_t current;
+        int spins = 0;
+        while ((current = round.load(std::memory_order_acquire)) == seen) {
+            if (spins < SPINS_BEFORE_PARK) {
+                relax(spins);
+            } else {
+                round.wait(seen, std::memory_order_acquire);
+            }
+        }
+        // Деструктор тоже начинает раунд, чтобы разбудить уснувших.
+        if (stop.load(std::memory_order_relaxed)) {
+            return;
+        }
+        seen = current;
+        (*job)(id);
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void SpinTeam::run(const std::function<void(int)>& new_job) {
+    job = &new_job;
+    remaining.store(threads.size(), std::memory_order_relaxed);
+    round.fetch_add(1, std::memory_order_release);
+    round.notify_all();
+    new_job(0);
+    int spins = 0;
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        relax(spins);
+    }
+}
+
+SpinTeam::~SpinTeam() {
+    stop.store(true, std::memory_order_relaxed);
+    round.fetch_add(1, std::memory_order_release);
+    round.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
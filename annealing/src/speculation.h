@@ -0,0 +1,39 @@
+#ifndef SRC_SPECULATION_H_
+#define SRC_SPECULATION_H_
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Команда потоков для раундов длиной в доли микросекунды: run(job)
+// выполняет job(i) в потоках команды для i = 1..size()-1 и в вызывающем
+// потоке для i = 0 и возвращается, когда закончили все. Между раундами
+// потоки ждут на атомарном номере раунда, сначала крутясь, потом уступая
+// процессор: пробуждение через condition_variable, как в ThreadPool,
+// дороже самого раунда. После долгого простоя (SPINS_BEFORE_PARK проверок) поток
+// засыпает в atomic::wait, и run будит его notify_all; пока спящих нет,
+// notify_all обходится без системного вызова. Идущие подряд раунды держат
+// потоки команды занятыми ожиданием, поэтому потоков не должно быть
+// больше свободных ядер.
+class SpinTeam {
+    std::vector<std::thread> threads;
+    alignas(64) std::atomic<std::uint64_t> round{0};
+    alignas(64) std::atomic<int> remaining{0};
+    const std::function<void(int)>* job = nullptr;
+    std::atomic<bool> stop{false};
+
+    void member_loop(int);
+
+public:
+    explicit SpinTeam(int size);
+    SpinTeam(const SpinTeam&) = delete;
+    SpinTeam& operator=(const SpinTeam&) = delete;
+
+    int size() const {return threads.size() + 1;}
+    void run(const std::function<void(int)>& job);
+
+    ~SpinTeam();
+};
+
+#endif // SRC_SPECULATION_H_
@@ -0,0 +1,36 @@
+#include "telemetry.h"
+
+void AnnealingTelemetry::write_json(std::ostream& out) const {
+    const char* phase_names[PHASES] = {"run", "best_sync"};
+    out << "{\n";
+    out << "  \"enabled\": " << (ENABLED ? "true" : "false") << ",\n";
+    out << "  \"proposed\": " << counters.proposed << ",\n";
+    out << "  \"accepted\": " << counters.accepted << ",\n";
+    out << "  \"uphill_accepted\": " << counters.uphill_accepted << ",\n";
+    out << "  \"improving\": " << counters.improving << ",\n";
+    out << "  \"moves_per_second\": " << moves_per_second() << ",\n";
+    out << "  \"phase_seconds\": {";
+    for (int i = 0; i < PHASES; ++i) {
+        out << (i ? ", " : "") << '"' << phase_names[i] << "\": " << phase_seconds[i];
+    }
+    out << "},\n";
+    out << "  \"trace\": [";
+    for (std::size_t i = 0; i < trace.size(); ++i) {
+        const TracePoint& point = trace[i];
+        out << (i ? ",\n    " : "\n    ")
+            << "{\"seconds\": " << point.seconds
+            << ", \"iter\": " << point.iter
+            << ", \"loss\": " << point.loss
+            << ", \"temp\": " << point.temp << '}';
+    }
+    out << (trace.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+void AnnealingTelemetry::write_csv(std::ostream& out) const {
+    out << "seconds,iter,loss,temp\n";
+    for (const TracePoint& point : trace) {
+        out << point.seconds << ',' << point.iter << ','
+            << point.loss << ',' << point.temp << '\n';
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef SRC_TELEMETRY_H_
+#define SRC_TELEMETRY_H_
+#include <chrono>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+// Сбор статистики включён по умолчанию: -DANNEALING_TELEMETRY=0 превращает
+// все методы AnnealingTelemetry в пустые и убирает их из цикла отжига.
+#ifndef ANNEALING_TELEMETRY
+#define ANNEALING_TELEMETRY 1
+#endif
+
+// Статистика одного прогона отжига: счётчики ходов, время по фазам
+// и трасса улучшений лучшей метрики с отметками времени и температурой.
+// Трасса пишется не чаще раза за итерацию внешнего цикла.
+class AnnealingTelemetry {
+public:
+    static constexpr bool ENABLED = ANNEALING_TELEMETRY;
+
+    // По фазам отдельного хода (предложение с оценкой, критерий, применение)
+    // телеметрия время не замеряет: ход занимает десятки наносекунд, и пара
+    // steady_clock::now() на каждом ходе стоила бы дороже самого хода
+    // и исказила бы moves_per_second. Предложение и оценка к тому же один
+    // вызов: propose возвращает изменение метрики. Доли фаз хода видны
+    // по счётчикам (proposed - оценки, accepted - применения), а их время
+    // замеряют пробы сборки с -DANNEALING_PROFILE=1 (profile.h).
+    enum Phase {
+        RUN,        // весь simulate_annealing
+        BEST_SYNC,  // материализация лучшего решения
+        PHASES
+    };
+
+    struct Counters {
+        long long proposed = 0;
+        long long accepted = 0;
+        long long uphill_accepted = 0;
+        long long improving = 0;
+    };
+
+    struct TracePoint {
+        double seconds;
+        long long iter;
+        long long loss;
+        double temp;
+    };
+
+    // Прибавляет время жизни объекта к фазе.
+    class ScopedPhase {
+        AnnealingTelemetry& telemetry;
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        ScopedPhase(AnnealingTelemetry& telemetry, Phase phase): telemetry(telemetry)
+                , phase(phase) {
+            if constexpr (ENABLED) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedPhase() {
+            if constexpr (ENABLED) {
+                std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+                telemetry.phase_seconds[phase] += spent.count();
+            }
+        }
+    };
+
+private:
+    Counters counters;
+    double phase_seconds[PHASES] = {};
+    std::vector<TracePoint> trace;
+    long long traced_loss = std::numeric_limits<long long>::max();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+    void proposed() {
+        if constexpr (ENABLED) {
+            ++counters.proposed;
+        }
+    }
+
+    void accepted(bool uphill, bool improving) {
+        if constexpr (ENABLED) {
+            ++counters.accepted;
+            counters.uphill_accepted += uphill;
+            counters.improving += improving;
+        }
+    }
+
+    void best(long long iter, long long loss, double temp) {
+        if constexpr (ENABLED) {
+            if (loss < traced_loss) {
+                traced_loss = loss;
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                trace.push_back({elapsed.count(), iter, loss, temp});
+            }
+        }
+    }
+
+    ScopedPhase phase(Phase p) {return ScopedPhase(*this, p);}
+
+    const Counters& get_counters() const {return counters;}
+    double get_phase_seconds(Phase p) const {return phase_seconds[p];}
+    const std::vector<TracePoint>& get_trace() const {return trace;}
+    // Предложенных ходов в секунду за фазу RUN.
+    double moves_per_second() const {
+        return phase_seconds[RUN] > 0 ? counters.proposed / phase_seconds[RUN] : 0;
+    }
+
+    // JSON: счётчики, фазы и трасса одним объектом.
+    void write_json(std::ostream&) const;
+    // CSV: только трасса, строка на точку.
+    void write_csv(std::ostream&) const;
+};
+
+#endif // SRC_TELEMETRY_H_
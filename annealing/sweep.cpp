@@ -0,0 +1,237 @@
+#include "src/annealing.h"
+#include "src/parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+    const std::vector<std::string> LAWS = {"mixed", "boltzmann", "cauchy", "adaptive"};
+
+    std::vector<std::string> split(const std::string& spec, char separator) {
+        std::vector<std::string> parts;
+        std::size_t start = 0;
+        while (start <= spec.size()) {
+            std::size_t end = std::min(spec.find(separator, start), spec.size());
+            parts.push_back(spec.substr(start, end - start));
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    // "2,4,8" - список, "300:6000:300" - от, до включительно, шаг.
+    std::vector<int> parse_values(const std::string& spec) {
+        std::vector<int> values;
+        for (const std::string& part : split(spec, ',')) {
+            std::vector<std::string> range = split(part, ':');
+            try {
+                if (range.size() == 1) {
+                    values.push_back(std::stoi(range[0]));
+                } else if (range.size() == 3 && std::stoi(range[2]) > 0) {
+                    for (int v = std::stoi(range[0]); v <= std::stoi(range[1]); v += std::stoi(range[2])) {
+                        values.push_back(v);
+                    }
+                } else {
+                    throw std::invalid_argument(part);
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error("Bad value list " + spec);
+            }
+        }
+        return values;
+    }
+
+    // То же, но все значения должны быть положительными и список непустым.
+    std::vector<int> parse_positive(const std::string& spec) {
+        std::vector<int> values = parse_values(spec);
+        if (values.empty() || *std::min_element(values.begin(), values.end()) <= 0) {
+            throw std::runtime_error("Values must be positive: " + spec);
+        }
+        return values;
+    }
+
+    int positive_value(const std::string& spec) {
+        std::vector<int> values = parse_positive(spec);
+        if (values.size() != 1) {
+            throw std::runtime_error("Expected one value: " + spec);
+        }
+        return values[0];
+    }
+
+    // Как input/generator.py: длительности равномерно из [lo, hi].
+    std::shared_ptr<const Instance> generate(int k, int n, int lo, int hi, Xoshiro256& gen) {
+        std::vector<std::int32_t> works(n);
+        for (std::int32_t& work : works) {
+            work = lo + gen.below(hi - lo + 1);
+        }
+        return std::make_shared<const Instance>(k, std::move(works));
+    }
+
+    struct Run {
+        int cell;
+        int law;
+        int rep;
+        std::uint64_t seed;
+        long long loss = 0;
+        long long iterations = 0;
+        double seconds = 0;
+    };
+
+    // Решения и мутация потока пула, общие для всех его прогонов.
+    struct alignas(64) Buffers {
+        ImplAnnealingSolution* solution = nullptr;
+        ImplAnnealingSolution* best_solution = nullptr;
+        ImplMutateSolution mutation;
+    };
+}
+
+int main (int argc, char *argv[]) {
+    // Сетка прогонов в одном процессе вместо experiment3 в experiment.py:
+    // --k и --n - списки или диапазоны (2:20:2), --laws - законы через
+    // запятую, --reps - повторов на ячейку, --works lo:hi - диапазон
+    // длительностей, --seed - зерно экземпляров и прогонов, --threads -
+    // потоков (по умолчанию все ядра), --out - CSV со строкой на прогон.
+    std::string k_spec = "2:20:2";
+    std::string n_spec = "300:6000:300";
+    std::string laws_spec = "boltzmann";
+    std::string works_spec = "10:100";
+    std::string out_file = "output/sweep.csv";
+    std::string reps_spec = "5";
+    std::string threads_spec = std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    std::uint64_t seed = random_seed();
+    for (int i = 1; i < argc; i += 2) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << arg << '\n';
+            exit(1);
+        }
+        if (arg == "--k") {
+            k_spec = argv[i + 1];
+        } else if (arg == "--n") {
+            n_spec = argv[i + 1];
+        } else if (arg == "--laws") {
+            laws_spec = argv[i + 1];
+        } else if (arg == "--works") {
+            works_spec = argv[i + 1];
+        } else if (arg == "--reps") {
+            reps_spec = argv[i + 1];
+        } else if (arg == "--seed") {
+            seed = std::stoull(argv[i + 1]);
+        } else if (arg == "--threads") {
+            threads_spec = argv[i + 1];
+        } else if (arg == "--out") {
+            out_file = argv[i + 1];
+        } else {
+            std::cerr << "Unknown option " << arg << '\n';
+            exit(1);
+        }
+    }
+    std::cerr << "seed: " << seed << '\n';
+
+    std::vector<int> ks, ns, works_range;
+    std::vector<std::string> laws = split(laws_spec, ',');
+    int reps = 0;
+    int threads = 0;
+    try {
+        ks = parse_positive(k_spec);
+        ns = parse_positive(n_spec);
+        reps = positive_value(reps_spec);
+        threads = positive_value(threads_spec);
+        for (const std::string& bound : split(works_spec, ':')) {
+            works_range.push_back(positive_value(bound));
+        }
+        if (works_range.size() != 2 || works_range[0] > works_range[1]) {
+            throw std::runtime_error("Bad duration range " + works_spec);
+        }
+        for (const std::string& law : laws) {
+            if (std::find(LAWS.begin(), LAWS.end(), law) == LAWS.end()) {
+                throw std::runtime_error("Unknown law " + law);
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        exit(1);
+    }
+
+    // Один экземпляр на ячейку (k, n), его делят все законы и повторы.
+    std::vector<std::shared_ptr<const Instance>> instances;
+    Xoshiro256 gen(seed);
+    for (int k : ks) {
+        for (int n : ns) {
+            instances.push_back(generate(k, n, works_range[0], works_range[1], gen));
+        }
+    }
+    std::vector<Run> runs;
+    for (int cell = 0; cell < int(instances.size()); ++cell) {
+        for (int law = 0; law < int(laws.size()); ++law) {
+            for (int rep = 0; rep < reps; ++rep) {
+                runs.push_back({cell, law, rep, seed + runs.size() + 1});
+            }
+        }
+    }
+
+    // Длинные прогоны (большие n) отправляются первыми, чтобы в конце
+    // сетки потоки не ждали одного долгого прогона.
+    std::vector<int> order(runs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return instances[runs[a].cell]->size() > instances[runs[b].cell]->size();
+    });
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<Buffers> buffers(threads);
+    ProfileReport profile;
+    {
+        WorkStealingPool pool(threads);
+        for (int index : order) {
+            pool.submit([&, index](int id) {
+                Run& run = runs[index];
+                const std::shared_ptr<const Instance>& instance = instances[run.cell];
+                Buffers& worker = buffers[id];
+                if (worker.solution == nullptr) {
+                    worker.solution = new ImplAnnealingSolution(instance);
+                    worker.best_solution = new ImplAnnealingSolution(*worker.solution);
+                } else {
+                    worker.solution->reset(instance);
+                }
+                *worker.best_solution = *worker.solution;
+                visit_law(laws[run.law], [&](auto& law) {
+                    BasicSimulateAnnealing sim(worker.solution, worker.best_solution, worker.mutation, law, 1000);
+                    sim.seed(run.seed);
+                    auto start = std::chrono::steady_clock::now();
+                    sim.simulate_annealing();
+                    std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+                    run.seconds = spent.count();
+                    run.loss = sim.get_best_loss();
+                    run.iterations = sim.get_iterations();
+                });
+            });
+        }
+        pool.wait();
+    }
+    for (Buffers& worker : buffers) {
+        delete worker.solution;
+        delete worker.best_solution;
+    }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - started;
+
+    std::ofstream out(out_file);
+    if (!out) {
+        std::cerr << "Can't create file " << out_file << '\n';
+        exit(1);
+    }
+    out << "k,n,law,rep,seed,loss,lower_bound,gap,iterations,seconds\n";
+    for (const Run& run : runs) {
+        const Instance& instance = *instances[run.cell];
+        long long lower_bound = instance.optimal_loss();
+        out << instance.procs() << ',' << instance.size() << ',' << laws[run.law] << ','
+            << run.rep << ',' << run.seed << ',' << run.loss << ',' << lower_bound << ','
+            << optimality_gap(run.loss, lower_bound) << ',' << run.iterations << ','
+            << run.seconds << '\n';
+    }
+    std::cerr << runs.size() << " runs on " << threads << " threads in " << wall.count() << "s\n";
+
+    return 0;
+}
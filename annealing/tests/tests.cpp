@@ -0,0 +1,1191 @@
+#include "../src/annealing.h"
+#include "../src/checkpoint.h"
+#include "../src/profile.h"
+#include "../src/queues.h"
+#include "../src/service.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Инкрементальные метрики, журнал отката, кадры решения, контрольные точки
+// и QueueArena сверяются с полным пересчётом на небольших случайных
+// экземплярах. make AVX2=1 test проверяет и векторное ядро move_deltas.
+
+namespace {
+    using Schedule = std::vector<std::vector<std::int32_t>>;
+
+    std::shared_ptr<const Instance> make_instance(int k, int n, std::uint64_t seed) {
+        Xoshiro256 gen(seed);
+        std::vector<std::int32_t> works(n);
+        for (std::int32_t& work : works) {
+            work = 1 + gen.below(100);
+        }
+        return std::make_shared<const Instance>(k, std::move(works));
+    }
+
+    std::vector<char> frame_of(const ImplAnnealingSolution& solution) {
+        std::vector<char> frame(solution.serialized_size());
+        solution.serialize(frame.data());
+        return frame;
+    }
+
+    // Очереди решения, прочитанные из его кадра.
+    Schedule queues_of(const ImplAnnealingSolution& solution, const Instance& instance) {
+        std::vector<char> frame = frame_of(solution);
+        const char* body = frame.data() + sizeof(ImplAnnealingSolution::WireHeader);
+        const char* payload = body + instance.procs() * sizeof(std::uint32_t);
+        Schedule queues(instance.procs());
+        for (int i = 0; i < instance.procs(); ++i) {
+            std::uint32_t length;
+            std::memcpy(&length, body + i * sizeof(length), sizeof(length));
+            for (std::uint32_t j = 0; j < length; ++j) {
+                std::int32_t work;
+                std::memcpy(&work, payload, sizeof(work));
+                queues[i].push_back(work);
+                payload += sizeof(work);
+            }
+        }
+        return queues;
+    }
+
+    // Сумма моментов завершения, посчитанная заново по очередям.
+    long long full_loss(const ImplAnnealingSolution& solution, const Instance& instance) {
+        long long loss = 0;
+        for (const std::vector<std::int32_t>& queue : queues_of(solution, instance)) {
+            long long finish = 0;
+            for (std::int32_t work : queue) {
+                finish += instance[work];
+                loss += finish;
+            }
+        }
+        return loss;
+    }
+
+    // Случайный допустимый ход вида type.
+    ImplAnnealingSolution::Move random_move(const ImplAnnealingSolution& solution, const Instance& instance
+                                            , ImplAnnealingSolution::MoveType type, Xoshiro256& gen) {
+        Schedule queues = queues_of(solution, instance);
+        ImplAnnealingSolution::Move move{int(gen.below(instance.size())), int(gen.below(instance.procs())), type};
+        int old_proc = 0;
+        int position = 0;
+        for (int i = 0; i < instance.procs(); ++i) {
+            auto it = std::find(queues[i].begin(), queues[i].end(), move.work);
+            if (it != queues[i].end()) {
+                old_proc = i;
+                position = it - queues[i].begin();
+            }
+        }
+        const std::vector<std::int32_t>& queue = queues[old_proc];
+        switch (type) {
+        case ImplAnnealingSolution::SWAP:
+            move.other = gen.below(instance.size());
+            break;
+        case ImplAnnealingSolution::EXCHANGE:
+            if (position + 1 < int(queue.size())) {
+                move.other = queue[position + 1];
+            } else if (position > 0) {
+                move.other = queue[position - 1];
+            } else {
+                move.other = move.work;
+            }
+            break;
+        case ImplAnnealingSolution::RELOCATE: {
+            int m = queues[move.proc].size() - (move.proc == old_proc);
+            move.other = gen.below(m + 1);
+            break;
+        }
+        default:
+            break;
+        }
+        return move;
+    }
+
+    ImplMutateSolution::MoveWeights all_moves() {
+        return ImplMutateSolution::MoveWeights::parse("end=1,swap=1,exchange=1,relocate=1");
+    }
+
+    // Временный файл, удаляется в деструкторе.
+    class TempFile {
+    public:
+        std::string path;
+
+        explicit TempFile(const std::string& name): path((std::filesystem::temp_directory_path()
+                / (name + "." + std::to_string(getpid()))).string()) {
+            std::remove(path.c_str());
+        }
+        ~TempFile() {std::remove(path.c_str());}
+    };
+}
+
+
+class MoveDeltas: public testing::TestWithParam<ImplAnnealingSolution::MoveType> {};
+
+TEST_P(MoveDeltas, MatchFullRecompute) {
+    auto instance = make_instance(7, 120, 1);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "greedy");
+    Xoshiro256 gen(2);
+    for (int i = 0; i < 2000; ++i) {
+        ImplAnnealingSolution::Move move = random_move(solution, *instance, GetParam(), gen);
+        long long before = solution.get_loss_metric();
+        long long delta = solution.move_delta(move);
+        solution.apply_move(move, delta);
+        long long loss = full_loss(solution, *instance);
+        ASSERT_EQ(before + delta, loss) << "move " << i;
+        ASSERT_EQ(solution.get_loss_metric(), loss);
+    }
+}
+
+TEST_P(MoveDeltas, UndoRestoresSolution) {
+    auto instance = make_instance(5, 80, 3);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "lpt");
+    Xoshiro256 gen(4);
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<char> frame = frame_of(solution);
+        long long loss = solution.get_loss_metric();
+        ImplAnnealingSolution::UndoRecord undo = solution.apply_move(random_move(solution, *instance, GetParam(), gen));
+        solution.undo_move(undo);
+        ASSERT_EQ(frame_of(solution), frame) << "move " << i;
+        ASSERT_EQ(solution.get_loss_metric(), loss);
+        // Дальше от другого решения.
+        solution.apply_move(random_move(solution, *instance, GetParam(), gen));
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllMoves, MoveDeltas, testing::Values(ImplAnnealingSolution::TO_END
+                                                               , ImplAnnealingSolution::SWAP
+                                                               , ImplAnnealingSolution::EXCHANGE
+                                                               , ImplAnnealingSolution::RELOCATE));
+
+TEST(BlockDeltas, MatchSingleMoves) {
+    auto instance = make_instance(9, 150, 5);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "spt");
+    Xoshiro256 gen(6);
+    std::uint32_t works[MutateSolution::MAX_BLOCK];
+    std::uint32_t procs[MutateSolution::MAX_BLOCK];
+    long long deltas[MutateSolution::MAX_BLOCK];
+    for (int round = 0; round < 300; ++round) {
+        // Длина блока не кратна восьми, чтобы задеть и скалярный хвост.
+        int count = 1 + gen.below(MutateSolution::MAX_BLOCK);
+        gen.fill_below(works, count, instance->size());
+        gen.fill_below(procs, count, instance->procs());
+        solution.move_deltas(works, procs, deltas, count);
+        for (int i = 0; i < count; ++i) {
+            ASSERT_EQ(deltas[i], solution.move_delta({int(works[i]), int(procs[i])})) << "move " << i;
+        }
+        solution.apply_move({int(works[0]), int(procs[0])}, deltas[0]);
+        ASSERT_EQ(solution.get_loss_metric(), full_loss(solution, *instance));
+    }
+}
+
+TEST(BlockDeltas, ProposedMoveAppliesWithItsDelta) {
+    auto instance = make_instance(6, 100, 7);
+    ImplAnnealingSolution solution = ImplAnnealingSolution(instance);
+    ImplMutateSolution mutation(8);
+    Xoshiro256 gen(9);
+    long long deltas[MutateSolution::MAX_BLOCK];
+    for (int round = 0; round < 500; ++round) {
+        int count = mutation.propose_block(&solution, deltas, 1 + gen.below(MutateSolution::MAX_BLOCK));
+        int index = gen.below(count);
+        long long before = solution.get_loss_metric();
+        mutation.apply_proposed(&solution, index);
+        ASSERT_EQ(before + deltas[index], full_loss(solution, *instance)) << "round " << round;
+    }
+}
+
+// Блок в две фазы с оценкой по отрезкам - тот же блок, что propose_block.
+TEST(BlockDeltas, DrawThenEvaluateMatchesPropose) {
+    auto instance = make_instance(6, 100, 58);
+    for (bool mixed : {false, true}) {
+        ImplAnnealingSolution solution = ImplAnnealingSolution(instance);
+        ImplAnnealingSolution twin = solution;
+        ImplMutateSolution mutation(59);
+        ImplMutateSolution split(59);
+        if (mixed) {
+            mutation.set_move_weights(all_moves());
+            split.set_move_weights(all_moves());
+        }
+        Xoshiro256 gen(60);
+        long long deltas[MutateSolution::MAX_BLOCK];
+        long long split_deltas[MutateSolution::MAX_BLOCK];
+        for (int round = 0; round < 200; ++round) {
+            int count = mutation.propose_block(&solution, deltas, 1 + gen.below(MutateSolution::MAX_BLOCK));
+            ASSERT_EQ(split.draw_block(&twin, count), count);
+            int middle = gen.below(count + 1);
+            split.evaluate_block(&twin, split_deltas, middle, count);
+            split.evaluate_block(&twin, split_deltas, 0, middle);
+            ASSERT_TRUE(std::equal(deltas, deltas + count, split_deltas)) << "round " << round;
+            int index = gen.below(count);
+            mutation.apply_proposed(&solution, index);
+            split.apply_proposed(&twin, index);
+            ASSERT_EQ(frame_of(solution), frame_of(twin));
+        }
+    }
+}
+
+TEST(Schedules, MovesKeepEveryWorkOnce) {
+    auto instance = make_instance(6, 100, 23);
+    ImplAnnealingSolution solution = ImplAnnealingSolution(instance);
+    Xoshiro256 gen(24);
+    for (int i = 0; i < 2000; ++i) {
+        solution.apply_move(random_move(solution, *instance, ImplAnnealingSolution::TO_END, gen));
+        std::vector<int> seen(instance->size());
+        for (const std::vector<std::int32_t>& queue : queues_of(solution, *instance)) {
+            for (std::int32_t work : queue) {
+                ASSERT_TRUE(work >= 0 && std::size_t(work) < instance->size()) << "move " << i;
+                ++seen[work];
+            }
+        }
+        ASSERT_EQ(std::size_t(std::count(seen.begin(), seen.end(), 1)), instance->size()) << "move " << i;
+    }
+}
+
+TEST(Schedules, ToEndKeepsQueueOrder) {
+    auto instance = make_instance(6, 100, 25);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "spt");
+    Xoshiro256 gen(26);
+    for (int i = 0; i < 2000; ++i) {
+        Schedule before = queues_of(solution, *instance);
+        ImplAnnealingSolution::Move move = random_move(solution, *instance, ImplAnnealingSolution::TO_END, gen);
+        solution.apply_move(move);
+        // Остальные работы остаются в прежнем порядке, перенесённая - в конце.
+        for (std::vector<std::int32_t>& queue : before) {
+            std::erase(queue, move.work);
+        }
+        before[move.proc].push_back(move.work);
+        ASSERT_EQ(queues_of(solution, *instance), before) << "move " << i;
+    }
+}
+
+TEST(Journal, RollbackRestoresStart) {
+    auto instance = make_instance(8, 200, 10);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "greedy");
+    ImplAnnealingSolution start = solution;
+    ImplMutateSolution mutation(11);
+    mutation.set_move_weights(all_moves());
+    for (int i = 0; i < 3000; ++i) {
+        long long before = solution.get_loss_metric();
+        long long delta = mutation.propose(&solution);
+        // Принимается примерно половина ходов, как в отжиге.
+        if (i % 2 == 0 || delta <= 0) {
+            mutation.apply(&solution);
+            ASSERT_EQ(before + delta, full_loss(solution, *instance)) << "move " << i;
+        }
+    }
+    ASSERT_GT(mutation.journal_size(), 0u);
+    mutation.rollback(&solution);
+    EXPECT_EQ(frame_of(solution), frame_of(start));
+    EXPECT_EQ(solution.get_loss_metric(), start.get_loss_metric());
+}
+
+TEST(Journal, LazyBestMatchesTrackedBest) {
+    auto instance = make_instance(4, 60, 12);
+    ImplAnnealingSolution solution = ImplAnnealingSolution(instance);
+    ImplAnnealingSolution best = solution;
+    ImplMutateSolution mutation(13);
+    mutation.set_move_weights(all_moves());
+    Xoshiro256 gen(14);
+    // Как в replace_solution: журнал начинается заново с каждого рекорда,
+    // лучшее решение - текущее с откаченным журналом.
+    long long best_loss = solution.get_loss_metric();
+    ImplAnnealingSolution tracked = solution;
+    for (int i = 0; i < 2000; ++i) {
+        long long delta = mutation.propose(&solution);
+        if (delta > 0 && gen.uniform() > 0.3) {
+            continue;
+        }
+        mutation.apply(&solution);
+        if (solution.get_loss_metric() < best_loss) {
+            best_loss = solution.get_loss_metric();
+            tracked = solution;
+            mutation.clear_journal();
+        }
+    }
+    best = solution;
+    mutation.rollback(&best);
+    EXPECT_EQ(best.get_loss_metric(), best_loss);
+    EXPECT_EQ(frame_of(best), frame_of(tracked));
+}
+
+TEST(Wire, SerializeRoundTrip) {
+    auto instance = make_instance(6, 90, 15);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "lpt");
+    ImplAnnealingSolution copy = ImplAnnealingSolution(instance);
+    std::vector<char> frame = frame_of(solution);
+    copy.deserialize(frame.data(), frame.size());
+    EXPECT_EQ(frame_of(copy), frame);
+    EXPECT_EQ(copy.get_loss_metric(), solution.get_loss_metric());
+}
+
+TEST(Wire, PipeRoundTrip) {
+    auto instance = make_instance(6, 90, 16);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "greedy");
+    ImplAnnealingSolution copy = ImplAnnealingSolution(instance);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    solution.to_bytes(fds[1]);
+    copy.from_bytes(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+    EXPECT_EQ(frame_of(copy), frame_of(solution));
+    EXPECT_EQ(copy.get_loss_metric(), solution.get_loss_metric());
+}
+
+TEST(Wire, CorruptedFrameIsRejected) {
+    auto instance = make_instance(6, 90, 17);
+    ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, "spt");
+    ImplAnnealingSolution copy = ImplAnnealingSolution(instance);
+    std::vector<char> frame = frame_of(solution);
+
+    std::vector<char> body = frame;
+    body.back() ^= 1;
+    EXPECT_THROW(copy.deserialize(body.data(), body.size()), std::runtime_error);
+
+    std::vector<char> checksum = frame;
+    checksum[offsetof(ImplAnnealingSolution::WireHeader, checksum)] ^= 1;
+    EXPECT_THROW(copy.deserialize(checksum.data(), checksum.size()), std::runtime_error);
+
+    EXPECT_THROW(copy.deserialize(frame.data(), frame.size() - 1), std::runtime_error);
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], body.data(), body.size()), ssize_t(body.size()));
+    EXPECT_THROW(copy.from_bytes(fds[0]), std::runtime_error);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(Wire, FrameOfAnotherInstanceIsRejected) {
+    ImplAnnealingSolution solution = ImplAnnealingSolution(make_instance(6, 90, 18));
+    ImplAnnealingSolution other = ImplAnnealingSolution(make_instance(5, 90, 18));
+    std::vector<char> frame = frame_of(solution);
+    EXPECT_THROW(other.deserialize(frame.data(), frame.size()), std::runtime_error);
+}
+
+// Размер блока, потоки спекуляции и смесь видов ходов. Спекуляция
+// работает только на блоках из TO_END.
+struct CheckpointCase {
+    int block_size;
+    int speculate;
+    bool mixed;
+};
+
+class Checkpoints: public testing::TestWithParam<CheckpointCase> {
+protected:
+    int block_size = CONFIG::MOVE_BLOCK_SIZE;
+
+    void SetUp() override {CONFIG::MOVE_BLOCK_SIZE = GetParam().block_size;}
+    void TearDown() override {CONFIG::MOVE_BLOCK_SIZE = block_size;}
+
+    void configure(ImplMutateSolution& mutation) {
+        if (GetParam().mixed) {
+            mutation.set_move_weights(all_moves());
+        }
+    }
+};
+
+TEST_P(Checkpoints, ResumeMatchesUninterruptedRun) {
+    auto instance = make_instance(5, 150, 19);
+    AdaptiveLaw law;
+    TempFile file("annealing_checkpoint");
+
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* best = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mutation(0);
+    configure(mutation);
+    BasicSimulateAnnealing full(solution, best, mutation, law, 1000);
+    full.seed(20);
+    full.set_speculation(GetParam().speculate);
+    full.simulate_annealing();
+
+    // Та же цепочка, остановленная после 300 итераций.
+    ImplAnnealingSolution* first_solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* first_best = new ImplAnnealingSolution(*first_solution);
+    ImplMutateSolution first_mutation(0);
+    configure(first_mutation);
+    BasicSimulateAnnealing first(first_solution, first_best, first_mutation, law, 1000);
+    first.seed(20);
+    first.set_speculation(GetParam().speculate);
+    first.begin();
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_TRUE(first.step());
+    }
+    {
+        SnapshotFile snapshot(file.path, first.checkpoint_size());
+        first.save_checkpoint(snapshot);
+    }
+
+    // Продолжение в новых объектах с другим зерном: всё состояние - из файла.
+    ImplAnnealingSolution* resumed_solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* resumed_best = new ImplAnnealingSolution(*resumed_solution);
+    ImplMutateSolution resumed_mutation(1);
+    configure(resumed_mutation);
+    BasicSimulateAnnealing resumed(resumed_solution, resumed_best, resumed_mutation, law, 1000);
+    resumed.seed(21);
+    resumed.set_speculation(GetParam().speculate);
+    SnapshotFile snapshot(file.path, resumed.checkpoint_size());
+    ASSERT_TRUE(resumed.load_checkpoint(snapshot));
+    EXPECT_EQ(resumed.get_iterations(), 300);
+    resumed.simulate_annealing();
+
+    EXPECT_EQ(resumed.get_iterations(), full.get_iterations());
+    EXPECT_EQ(resumed.get_best_loss(), full.get_best_loss());
+    EXPECT_EQ(frame_of(*resumed.get_solution()), frame_of(*full.get_solution()));
+
+    full.clear();
+    first.clear();
+    resumed.clear();
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSizes, Checkpoints, testing::Values(CheckpointCase{1, 1, true}
+                                                                  , CheckpointCase{16, 1, true}
+                                                                  , CheckpointCase{MutateSolution::MAX_BLOCK, 3, false}));
+
+namespace {
+    const std::string FIRST_RECORD = "first record";
+    const std::string SECOND_RECORD = "second record, a bit longer";
+
+    // Две записи: первая в первой области, вторая - во второй.
+    void write_two_records(const std::string& path) {
+        SnapshotFile snapshot(path, 64);
+        EXPECT_TRUE(snapshot.empty());
+        std::memcpy(snapshot.begin_write(), FIRST_RECORD.data(), FIRST_RECORD.size());
+        snapshot.commit(FIRST_RECORD.size());
+        std::memcpy(snapshot.begin_write(), SECOND_RECORD.data(), SECOND_RECORD.size());
+        snapshot.commit(SECOND_RECORD.size());
+    }
+}
+
+TEST(SnapshotFiles, TornWriteKeepsLatestRecord) {
+    TempFile file("annealing_snapshot");
+    write_two_records(file.path);
+    {
+        // Третья запись затирает область первой и не доходит до commit.
+        SnapshotFile snapshot(file.path, 64);
+        std::memset(snapshot.begin_write(), 'x', 64);
+        EXPECT_EQ(std::string(snapshot.data(), snapshot.size()), SECOND_RECORD);
+    }
+    SnapshotFile snapshot(file.path, 64);
+    ASSERT_FALSE(snapshot.empty());
+    EXPECT_EQ(std::string(snapshot.data(), snapshot.size()), SECOND_RECORD);
+}
+
+TEST(SnapshotFiles, CorruptedRecordFallsBackToPrevious) {
+    TempFile file("annealing_snapshot");
+    write_two_records(file.path);
+    // Портим данные последней записи: остаётся предыдущая.
+    std::FILE* out = std::fopen(file.path.c_str(), "r+b");
+    ASSERT_NE(out, nullptr);
+    std::size_t capacity = 64;
+    std::fseek(out, sizeof(SnapshotFile::FileHeader) + 2 * sizeof(SnapshotFile::SlotHeader) + capacity, SEEK_SET);
+    std::fputc('?', out);
+    std::fclose(out);
+    SnapshotFile snapshot(file.path, 64);
+    ASSERT_FALSE(snapshot.empty());
+    EXPECT_EQ(std::string(snapshot.data(), snapshot.size()), FIRST_RECORD);
+}
+
+TEST(SnapshotFiles, SmallerFileIsRejected) {
+    TempFile file("annealing_snapshot_small");
+    {
+        SnapshotFile snapshot(file.path, 64);
+    }
+    EXPECT_THROW(SnapshotFile(file.path, 128), std::runtime_error);
+}
+
+TEST(QueueArenas, RandomEditsMatchVectors) {
+    // Массив на 40 работ: хвост кончается часто, и compact работает
+    // на каждом десятке правок.
+    const int k = 6;
+    const int n = 40;
+    QueueArena arena;
+    arena.reset(k, n);
+    Schedule reference(k);
+    Xoshiro256 gen(22);
+    int total = 0;
+    for (int i = 0; i < 20000; ++i) {
+        int q = gen.below(k);
+        int length = reference[q].size();
+        std::uint32_t op = gen.below(5);
+        if (op == 0 && total < n) {
+            arena.push_back(q, i);
+            reference[q].push_back(i);
+            ++total;
+        } else if (op == 1 && total < n) {
+            int position = gen.below(length + 1);
+            arena.insert(q, position, i);
+            reference[q].insert(reference[q].begin() + position, i);
+            ++total;
+        } else if (op == 2 && length > 0) {
+            int position = gen.below(length);
+            arena.erase(q, position);
+            reference[q].erase(reference[q].begin() + position);
+            --total;
+        } else if (op == 3 && length > 0) {
+            arena.pop_back(q);
+            reference[q].pop_back();
+            --total;
+        } else if (op == 4 && total + 3 <= n) {
+            std::int32_t* tail = arena.extend(q, 3);
+            for (int j = 0; j < 3; ++j) {
+                tail[j] = i + j;
+                reference[q].push_back(i + j);
+            }
+            total += 3;
+        }
+        for (int p = 0; p < k; ++p) {
+            ASSERT_EQ(arena.size(p), int(reference[p].size())) << "edit " << i;
+            ASSERT_THAT(std::vector<std::int32_t>(arena.data(p), arena.data(p) + arena.size(p))
+                        , testing::ElementsAreArray(reference[p])) << "edit " << i;
+        }
+    }
+}
+
+TEST(QueueArenas, CopyIsPacked) {
+    QueueArena arena;
+    arena.reset(3, 30);
+    for (int i = 0; i < 30; ++i) {
+        arena.push_back(i % 3, i);
+    }
+    QueueArena copy = arena;
+    for (int q = 0; q < 3; ++q) {
+        ASSERT_EQ(copy.size(q), arena.size(q));
+        EXPECT_TRUE(std::equal(copy.data(q), copy.data(q) + copy.size(q), arena.data(q)));
+    }
+    // Копия растёт независимо от оригинала.
+    copy.push_back(0, 100);
+    EXPECT_EQ(copy.back(0), 100);
+    EXPECT_EQ(arena.back(0), 27);
+}
+
+TEST(QueueArenas, TooManyWorksThrow) {
+    QueueArena arena;
+    EXPECT_THROW(arena.reset(std::numeric_limits<std::int32_t>::max(), 2), std::runtime_error);
+}
+
+// Загрузчики экземпляров: CSV -> бинарный файл -> экземпляр и отказ
+// на испорченных данных.
+namespace {
+    void write_file(const std::string& path, const std::string& text) {
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    std::vector<std::int32_t> works_of(const Instance& instance) {
+        return std::vector<std::int32_t>(instance.durations(), instance.durations() + instance.size());
+    }
+}
+
+TEST(Instances, CsvAndBinaryRoundTrip) {
+    TempFile csv("annealing_instance.csv");
+    TempFile binary("annealing_instance.bin");
+    write_file(csv.path, "3,5,0\n7 2,9\n");
+    auto instance = Instance::load(csv.path);
+    EXPECT_EQ(instance->procs(), 3);
+    EXPECT_THAT(works_of(*instance), testing::ElementsAre(5, 0, 7, 2, 9));
+
+    instance->save_binary(binary.path);
+    auto loaded = Instance::load(binary.path);
+    EXPECT_EQ(loaded->procs(), 3);
+    EXPECT_EQ(works_of(*loaded), works_of(*instance));
+    EXPECT_EQ(loaded->optimal_loss(), instance->optimal_loss());
+}
+
+TEST(Instances, MalformedCsvIsRejected) {
+    TempFile file("annealing_instance.csv");
+    for (const char* text : {"", "0,1,2", "3", "3,4,-5", "2,99999999999"}) {
+        write_file(file.path, text);
+        EXPECT_THROW(Instance::from_csv(file.path), std::runtime_error) << text;
+    }
+    EXPECT_THROW(Instance::load(file.path + ".missing"), std::runtime_error);
+}
+
+TEST(Instances, MalformedBinaryIsRejected) {
+    TempFile file("annealing_instance.bin");
+    make_instance(4, 10, 27)->save_binary(file.path);
+    std::ifstream in(file.path, std::ios::binary);
+    std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Instance::BinaryHeader header;
+    std::memcpy(&header, image.data(), sizeof(header));
+
+    std::vector<std::string> broken = {image.substr(0, image.size() - 1), image.substr(0, 10), image + "x"};
+    broken.push_back(image);
+    broken.back()[0] = 'X';
+    for (std::uint32_t k : {0u, std::uint32_t(std::numeric_limits<std::int32_t>::max()) + 1}) {
+        Instance::BinaryHeader bad = header;
+        bad.k = k;
+        broken.push_back(image);
+        std::memcpy(broken.back().data(), &bad, sizeof(bad));
+    }
+    for (std::size_t i = 0; i < broken.size(); ++i) {
+        write_file(file.path, broken[i]);
+        EXPECT_THROW(Instance::from_binary(file.path), std::runtime_error) << "case " << i;
+    }
+}
+
+TEST(Instances, ConstructorChecksArguments) {
+    EXPECT_THROW(Instance(0, {1, 2}), std::invalid_argument);
+    EXPECT_THROW(Instance(-2, {1, 2}), std::invalid_argument);
+    EXPECT_THROW(Instance(2, {}), std::invalid_argument);
+    EXPECT_THROW(Instance(2, {1, -1}), std::invalid_argument);
+    EXPECT_NO_THROW(Instance(2, {0, 1}));
+}
+
+// Протокол резидентного решателя: SolverService на временном сокете
+// в отдельном потоке и клиент на том же сокете.
+class Daemon: public testing::Test {
+protected:
+    TempFile socket_file{"annealing_daemon.sock"};
+    SolverService service{2};
+    std::thread server;
+
+    void SetUp() override {
+        server = std::thread([this]() {service.serve(socket_file.path);});
+    }
+
+    void TearDown() override {
+        service.stop();
+        server.join();
+    }
+
+    // Соединение с решателем; serve создаёт сокет не сразу.
+    int connect_client() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_file.path.c_str(), sizeof(address.sun_path) - 1);
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+                return fd;
+            }
+            close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ADD_FAILURE() << "can't connect to " << socket_file.path;
+        return -1;
+    }
+
+    static SolveRequest request(std::uint64_t id, std::uint32_t k, std::uint64_t n) {
+        SolveRequest request{};
+        std::memcpy(request.magic, SolverService::REQUEST_MAGIC, sizeof(request.magic));
+        request.id = id;
+        request.k = k;
+        request.n = n;
+        request.seed = id;
+        request.init = 1;
+        return request;
+    }
+
+    // Запрос одним куском. На испорченный заголовок решатель может закрыть
+    // соединение раньше, чем дочитает тело, поэтому без SIGPIPE.
+    static ssize_t send_request(int fd, const SolveRequest& request, const std::vector<std::int32_t>& works) {
+        std::vector<char> bytes(sizeof(request) + works.size() * sizeof(std::int32_t));
+        std::memcpy(bytes.data(), &request, sizeof(request));
+        if (!works.empty()) {
+            std::memcpy(bytes.data() + sizeof(request), works.data(), works.size() * sizeof(std::int32_t));
+        }
+        return send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    }
+
+    static bool read_exact(int fd, void* data, std::size_t size) {
+        char* out = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t got = read(fd, out, size);
+            if (got <= 0) {
+                return false;
+            }
+            out += got;
+            size -= got;
+        }
+        return true;
+    }
+};
+
+TEST_F(Daemon, RequestGetsResultWithSolutionFrame) {
+    auto instance = make_instance(3, 40, 28);
+    std::vector<std::int32_t> works(instance->durations(), instance->durations() + instance->size());
+    int fd = connect_client();
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(send_request(fd, request(7, 3, works.size()), works)
+              , ssize_t(sizeof(SolveRequest) + works.size() * sizeof(std::int32_t)));
+
+    SolveResponse response;
+    ASSERT_TRUE(read_exact(fd, &response, sizeof(response)));
+    EXPECT_EQ(std::memcmp(response.magic, SolverService::RESPONSE_MAGIC, sizeof(response.magic)), 0);
+    EXPECT_EQ(response.id, 7u);
+    ASSERT_EQ(response.kind, SolveResponse::RESULT);
+    EXPECT_EQ(response.lower_bound, instance->optimal_loss());
+    EXPECT_GE(response.loss, response.lower_bound);
+    EXPECT_GT(response.iterations, 0);
+
+    std::vector<char> frame(response.frame_size);
+    ASSERT_TRUE(read_exact(fd, frame.data(), frame.size()));
+    ImplAnnealingSolution solution(instance);
+    solution.deserialize(frame.data(), frame.size());
+    EXPECT_EQ(full_loss(solution, *instance), response.loss);
+    close(fd);
+}
+
+TEST_F(Daemon, MalformedRequestsAreRejected) {
+    std::vector<std::int32_t> works = {3, 1, 4, 1, 5};
+    std::vector<std::pair<SolveRequest, std::vector<std::int32_t>>> bad;
+    bad.push_back({request(1, 2, 5), works});
+    bad.back().first.magic[0] = 'X';
+    bad.push_back({request(2, 2, 0), {}});
+    bad.push_back({request(3, 0, 5), works});
+    bad.push_back({request(4, 6, 5), works});
+    bad.push_back({request(5, 2, 5), works});
+    bad.back().first.law = std::size(SolverService::LAWS);
+    bad.push_back({request(6, 2, 5), works});
+    bad.back().first.init = std::size(SolverService::INITS);
+    bad.push_back({request(7, 2, 5), {3, 1, -4, 1, 5}});
+    bad.push_back({request(8, 2, SolverService::MAX_WORKS + 1), {}});
+
+    for (const auto& [request, body] : bad) {
+        int fd = connect_client();
+        ASSERT_NE(fd, -1);
+        send_request(fd, request, body);
+        SolveResponse response;
+        ASSERT_TRUE(read_exact(fd, &response, sizeof(response))) << "request " << request.id;
+        EXPECT_EQ(response.kind, SolveResponse::ERROR) << "request " << request.id;
+        // После ошибки решатель закрывает соединение.
+        char byte;
+        EXPECT_EQ(read(fd, &byte, 1), 0) << "request " << request.id;
+        close(fd);
+    }
+
+    // Решатель продолжает работать.
+    int fd = connect_client();
+    ASSERT_NE(fd, -1);
+    ASSERT_GT(send_request(fd, request(9, 2, works.size()), works), 0);
+    SolveResponse response;
+    ASSERT_TRUE(read_exact(fd, &response, sizeof(response)));
+    EXPECT_EQ(response.kind, SolveResponse::RESULT);
+    EXPECT_EQ(response.id, 9u);
+    close(fd);
+}
+
+// Начальные расписания: перестановка работ, верная метрика, сортировка
+// очередей и та же раскладка при построении на месте.
+class InitialSchedules: public testing::TestWithParam<std::string> {};
+
+TEST_P(InitialSchedules, ArePermutationsWithSortedQueues) {
+    for (auto [k, n] : {std::pair{1, 1}, {3, 2}, {4, 37}, {9, 300}}) {
+        auto instance = make_instance(k, n, 29 + n);
+        ImplAnnealingSolution solution = ImplAnnealingSolution::initial(instance, GetParam());
+        EXPECT_EQ(solution.get_loss_metric(), full_loss(solution, *instance));
+        EXPECT_GE(solution.get_loss_metric(), instance->optimal_loss());
+        std::vector<std::int32_t> all;
+        for (const std::vector<std::int32_t>& queue : queues_of(solution, *instance)) {
+            all.insert(all.end(), queue.begin(), queue.end());
+            if (GetParam() != "single") {
+                EXPECT_TRUE(std::is_sorted(queue.begin(), queue.end(), [&](std::int32_t a, std::int32_t b) {
+                    return (*instance)[a] < (*instance)[b];
+                })) << "k = " << k << ", n = " << n;
+            }
+        }
+        std::sort(all.begin(), all.end());
+        std::vector<std::int32_t> expected(n);
+        std::iota(expected.begin(), expected.end(), 0);
+        EXPECT_EQ(all, expected);
+    }
+}
+
+TEST_P(InitialSchedules, ResetBuildsTheSameScheduleInPlace) {
+    auto instance = make_instance(5, 120, 30);
+    ImplAnnealingSolution solution(make_instance(7, 200, 31));
+    solution.apply_move({3, 4});
+    solution.reset(instance, GetParam());
+    EXPECT_EQ(frame_of(solution), frame_of(ImplAnnealingSolution::initial(instance, GetParam())));
+    EXPECT_EQ(solution.get_loss_metric(), full_loss(solution, *instance));
+}
+
+INSTANTIATE_TEST_SUITE_P(Methods, InitialSchedules, testing::Values("single", "spt", "lpt", "greedy"));
+
+TEST(InitialScheduleNames, SptIsOptimalAndUnknownNameThrows) {
+    auto instance = make_instance(6, 150, 32);
+    EXPECT_EQ(ImplAnnealingSolution::initial(instance, "spt").get_loss_metric(), instance->optimal_loss());
+    EXPECT_THROW(ImplAnnealingSolution::initial(instance, "random"), std::runtime_error);
+}
+
+namespace {
+    // Оптимум перебором всех k^n раскладок; внутри очереди работы
+    // по возрастанию длительности.
+    long long brute_force_optimum(int k, const std::vector<std::int32_t>& works) {
+        int n = works.size();
+        long long best = std::numeric_limits<long long>::max();
+        std::vector<int> binding(n, 0);
+        while (true) {
+            long long loss = 0;
+            for (int proc = 0; proc < k; ++proc) {
+                std::vector<std::int32_t> queue;
+                for (int i = 0; i < n; ++i) {
+                    if (binding[i] == proc) {
+                        queue.push_back(works[i]);
+                    }
+                }
+                std::sort(queue.begin(), queue.end());
+                long long finish = 0;
+                for (std::int32_t work : queue) {
+                    finish += work;
+                    loss += finish;
+                }
+            }
+            best = std::min(best, loss);
+            int i = 0;
+            while (i < n && ++binding[i] == k) {
+                binding[i++] = 0;
+            }
+            if (i == n) {
+                return best;
+            }
+        }
+    }
+}
+
+TEST(OptimalLoss, MatchesBruteForce) {
+    Xoshiro256 gen(33);
+    for (int round = 0; round < 60; ++round) {
+        int k = 1 + gen.below(3);
+        int n = 1 + gen.below(7);
+        std::vector<std::int32_t> works(n);
+        for (std::int32_t& work : works) {
+            // Малый диапазон, чтобы чаще встречались равные длительности.
+            work = gen.below(6);
+        }
+        Instance instance(k, works);
+        ASSERT_EQ(instance.optimal_loss(), brute_force_optimum(k, works)) << "k = " << k << ", n = " << n;
+    }
+}
+
+TEST(OptimalLoss, GapStopsTheRun) {
+    double gap = CONFIG::OPTIMALITY_GAP;
+    CONFIG::OPTIMALITY_GAP = 0.05;
+    auto instance = make_instance(4, 80, 34);
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* best = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mutation(35);
+    mutation.set_move_weights(all_moves());
+    BoltzmannLaw law;
+    BasicSimulateAnnealing sim(solution, best, mutation, law, 1000);
+    sim.seed(36);
+    sim.simulate_annealing();
+    CONFIG::OPTIMALITY_GAP = gap;
+    EXPECT_EQ(sim.get_stop_reason(), decltype(sim)::GAP_REACHED);
+    EXPECT_LE(sim.get_optimality_gap(), 0.05);
+    EXPECT_EQ(sim.get_best_loss(), full_loss(*sim.get_solution(), *instance));
+    sim.clear();
+}
+
+TEST(Telemetry, CountersAndTraceMatchTheRun) {
+    if (!AnnealingTelemetry::ENABLED) {
+        GTEST_SKIP() << "built with ANNEALING_TELEMETRY=0";
+    }
+    auto instance = make_instance(4, 100, 37);
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* best = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mutation(38);
+    BoltzmannLaw law;
+    BasicSimulateAnnealing sim(solution, best, mutation, law, 1000);
+    sim.seed(39);
+    long long start_loss = solution->get_loss_metric();
+    sim.simulate_annealing();
+
+    const AnnealingTelemetry& telemetry = sim.get_telemetry();
+    const AnnealingTelemetry::Counters& counters = telemetry.get_counters();
+    EXPECT_EQ(counters.proposed, sim.get_iterations() * CONFIG::STEPS_WITHOUT_TEMP_DECREASE);
+    EXPECT_GT(counters.accepted, 0);
+    EXPECT_LE(counters.accepted, counters.proposed);
+    EXPECT_LE(counters.uphill_accepted + counters.improving, counters.accepted);
+    EXPECT_GT(counters.improving, 0);
+    EXPECT_GT(telemetry.get_phase_seconds(AnnealingTelemetry::RUN), 0);
+    EXPECT_GT(telemetry.moves_per_second(), 0);
+
+    // Трасса - строго убывающие рекорды, последний - лучшая метрика прогона.
+    const std::vector<AnnealingTelemetry::TracePoint>& trace = telemetry.get_trace();
+    ASSERT_FALSE(trace.empty());
+    EXPECT_LE(trace.front().loss, start_loss);
+    for (std::size_t i = 1; i < trace.size(); ++i) {
+        EXPECT_LT(trace[i].loss, trace[i - 1].loss);
+        EXPECT_GE(trace[i].iter, trace[i - 1].iter);
+        EXPECT_GE(trace[i].seconds, trace[i - 1].seconds);
+    }
+    EXPECT_EQ(trace.back().loss, sim.get_best_loss());
+
+    std::ostringstream csv;
+    telemetry.write_csv(csv);
+    std::string lines = csv.str();
+    EXPECT_EQ(std::count(lines.begin(), lines.end(), '\n'), std::ptrdiff_t(trace.size() + 1));
+    std::ostringstream json;
+    telemetry.write_json(json);
+    EXPECT_THAT(json.str(), testing::HasSubstr("\"proposed\": " + std::to_string(counters.proposed)));
+    sim.clear();
+}
+
+TEST(AdaptiveLaws, InitialTemperatureAcceptsMeanUphillMove) {
+    AdaptiveLaw law(0.8);
+    EXPECT_EQ(law.calibration_samples(), 1000);
+    double temp = law.initial_temperature(50, 1000);
+    EXPECT_NEAR(std::exp(-50 / temp), 0.8, 1e-12);
+    // Без ухудшающих ходов калибровать не по чему.
+    EXPECT_EQ(law.initial_temperature(0, 1000), 1000);
+}
+
+TEST(AdaptiveLaws, CoolingFollowsAcceptance) {
+    AdaptiveLaw law(0.8, 0.05, 0.9, 0.99, 100, 0.3);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.2, 1), 10 * 0.9);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.01, 1), 10 * 0.99);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.01, 0), 10 * 0.99);
+    // Застой: подогрев до reheat * start_temp, но не охлаждение.
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.01, 100), 300);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.01, 200), 300);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 500, 0.01, 100), 500);
+    EXPECT_DOUBLE_EQ(law.next(1000, 1, 10, 0.01, 150), 10 * 0.99);
+}
+
+TEST(AdaptiveLaws, CalibratedRunImproves) {
+    auto instance = make_instance(4, 100, 40);
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+    ImplAnnealingSolution* best = new ImplAnnealingSolution(*solution);
+    ImplMutateSolution mutation(41);
+    mutation.set_move_weights(all_moves());
+    AdaptiveLaw law;
+    BasicSimulateAnnealing sim(solution, best, mutation, law, 1000);
+    sim.seed(42);
+    sim.simulate_annealing();
+    EXPECT_LE(sim.get_optimality_gap(), 0.01);
+    EXPECT_EQ(sim.get_best_loss(), full_loss(*sim.get_solution(), *instance));
+    sim.clear();
+}
+
+// Прогоны, которые останавливают только ограничения: без критериев застоя
+// и отклонения от нижней границы.
+class RunLimits: public testing::Test {
+protected:
+    int max_iter = CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT;
+    double gap = CONFIG::OPTIMALITY_GAP;
+    int check_interval = CONFIG::DEADLINE_CHECK_INTERVAL;
+    int publish_ms = CONFIG::BEST_PUBLISH_MS;
+
+    std::shared_ptr<const Instance> instance = make_instance(8, 2000, 43);
+    ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+    ImplMutateSolution mutation{44};
+    BoltzmannLaw law;
+    BasicSimulateAnnealing<ImplAnnealingSolution, ImplMutateSolution, BoltzmannLaw> sim{
+        solution, new ImplAnnealingSolution(*solution), mutation, law, 1000};
+
+    void SetUp() override {
+        CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT = std::numeric_limits<int>::max();
+        CONFIG::OPTIMALITY_GAP = -1;
+        CONFIG::DEADLINE_CHECK_INTERVAL = 1;
+        CONFIG::BEST_PUBLISH_MS = 0;
+        mutation.set_move_weights(all_moves());
+        sim.seed(45);
+    }
+    void TearDown() override {
+        sim.clear();
+        CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT = max_iter;
+        CONFIG::OPTIMALITY_GAP = gap;
+        CONFIG::DEADLINE_CHECK_INTERVAL = check_interval;
+        CONFIG::BEST_PUBLISH_MS = publish_ms;
+    }
+};
+
+TEST_F(RunLimits, DeadlineStopsTheRun) {
+    auto start = std::chrono::steady_clock::now();
+    sim.set_deadline(start + std::chrono::milliseconds(50));
+    sim.simulate_annealing();
+    EXPECT_EQ(sim.get_stop_reason(), decltype(sim)::DEADLINE);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    EXPECT_GT(sim.get_iterations(), 0);
+    EXPECT_EQ(sim.get_best_loss(), full_loss(*sim.get_solution(), *instance));
+}
+
+TEST_F(RunLimits, CancelFromAnotherThread) {
+    CancellationToken token;
+    sim.set_cancellation(&token);
+    std::thread canceller([&token] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        token.cancel();
+    });
+    sim.simulate_annealing();
+    canceller.join();
+    EXPECT_EQ(sim.get_stop_reason(), decltype(sim)::CANCELLED);
+    EXPECT_EQ(sim.get_best_loss(), full_loss(*sim.get_solution(), *instance));
+}
+
+TEST_F(RunLimits, SnapshotPublishesTheBest) {
+    BestSnapshot snapshot(solution->serialized_size());
+    std::vector<char> frame;
+    EXPECT_FALSE(snapshot.read(frame));
+    EXPECT_EQ(snapshot.loss(), std::numeric_limits<long long>::max());
+
+    // Читатель в другом потоке видит только целые кадры: метрика кадра
+    // совпадает с опубликованной рядом с ним и не растёт от чтения к чтению.
+    std::atomic<bool> done{false};
+    int reads = 0;
+    bool consistent = true;
+    std::thread reader([&] {
+        ImplAnnealingSolution copy(instance);
+        std::vector<char> seen;
+        long long last = std::numeric_limits<long long>::max();
+        while (!done.load()) {
+            long long loss;
+            if (snapshot.read(seen, &loss)) {
+                copy.deserialize(seen.data(), seen.size());
+                consistent &= copy.get_loss_metric() == loss && loss <= last;
+                last = loss;
+                ++reads;
+            }
+        }
+    });
+    sim.set_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+    sim.set_best_snapshot(&snapshot);
+    sim.simulate_annealing();
+    done = true;
+    reader.join();
+    EXPECT_TRUE(consistent);
+    EXPECT_GT(reads, 0);
+
+    long long loss;
+    long long iter;
+    ASSERT_TRUE(snapshot.read(frame, &loss, &iter));
+    EXPECT_EQ(loss, sim.get_best_loss());
+    EXPECT_EQ(snapshot.loss(), sim.get_best_loss());
+    EXPECT_LE(iter, sim.get_iterations());
+    EXPECT_EQ(frame, frame_of(*sim.get_solution()));
+}
+
+// Параллельные движки: лучшее решение не хуже начального, а его метрика
+// совпадает с пересчитанной по кадру.
+TEST(ParallelEngines, ChainsImproveTheStart) {
+    auto instance = make_instance(4, 100, 46);
+    ImplAnnealingSolution start(instance);
+    ImplMutateSolution mutation(47);
+    mutation.set_move_weights(all_moves());
+    BoltzmannLaw law;
+    BasicParallelSimulateAnnealing sim(start, mutation, law, 1000, 3, 48);
+    sim.simulate_annealing();
+    EXPECT_LT(sim.get_solution()->get_loss_metric(), start.get_loss_metric());
+    EXPECT_EQ(sim.get_solution()->get_loss_metric(), full_loss(*sim.get_solution(), *instance));
+}
+
+TEST(ParallelEngines, ReplicaExchangeImprovesTheStart) {
+    auto instance = make_instance(4, 100, 49);
+    ImplAnnealingSolution start(instance);
+    ImplMutateSolution mutation(50);
+    mutation.set_move_weights(all_moves());
+    BasicReplicaExchangeAnnealing sim(start, mutation, 1, 1000, 3, 51);
+    sim.simulate_annealing(0.2);
+    EXPECT_LT(sim.get_solution()->get_loss_metric(), start.get_loss_metric());
+    EXPECT_EQ(sim.get_solution()->get_loss_metric(), full_loss(*sim.get_solution(), *instance));
+}
+
+TEST(ParallelEngines, IslandsImproveTheStart) {
+    auto instance = make_instance(4, 100, 52);
+    ImplAnnealingSolution start(instance);
+    ImplMutateSolution mutation(53);
+    mutation.set_move_weights(all_moves());
+    BoltzmannLaw law;
+    for (MigrationTopology topology : {MigrationTopology::RING, MigrationTopology::BROADCAST}) {
+        BasicIslandAnnealing sim(start, mutation, law, 1000, 3, topology, 54);
+        sim.simulate_annealing(0.1);
+        EXPECT_LT(sim.get_solution()->get_loss_metric(), start.get_loss_metric());
+        EXPECT_EQ(sim.get_solution()->get_loss_metric(), full_loss(*sim.get_solution(), *instance));
+    }
+}
+
+TEST(ParallelEngines, RacingImprovesTheStartForAnyThreadCount) {
+    auto instance = make_instance(4, 100, 55);
+    ImplAnnealingSolution start(instance);
+    ImplMutateSolution mutation(56);
+    mutation.set_move_weights(all_moves());
+    BoltzmannLaw law;
+    std::vector<char> frames[2];
+    for (int threads : {1, 3}) {
+        BasicRacingAnnealing sim(start, mutation, law, 1000, 6, threads, 57);
+        sim.simulate_annealing(20000);
+        EXPECT_LT(sim.get_solution()->get_loss_metric(), start.get_loss_metric());
+        EXPECT_EQ(sim.get_solution()->get_loss_metric(), full_loss(*sim.get_solution(), *instance));
+        frames[threads > 1] = frame_of(*sim.get_solution());
+    }
+    // Отсев идёт между раундами: число потоков на результат не влияет.
+    EXPECT_EQ(frames[0], frames[1]);
+}
+
+// Уснувшие после простоя потоки команды просыпаются к следующему раунду.
+TEST(SpinTeams, RoundsAfterIdle) {
+    SpinTeam team(3);
+    std::vector<int> runs(team.size());
+    std::function<void(int)> job = [&runs](int i) {++runs[i];};
+    team.run(job);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    team.run(job);
+    team.run(job);
+    EXPECT_THAT(runs, testing::Each(3));
+}
+
+// Спекуляция делит между потоками только оценку блока: с тем же зерном
+// траектория та же, что в одном потоке.
+TEST(Speculation, ReproducesTheSequentialRun) {
+    int block_size = CONFIG::MOVE_BLOCK_SIZE;
+    int max_iter = CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT;
+    CONFIG::MOVE_BLOCK_SIZE = MutateSolution::MAX_BLOCK;
+    // Длинная холодная стадия: там блоки длинные и оцениваются командой.
+    CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT = 5000;
+    auto instance = make_instance(8, 400, 61);
+    for (bool mixed : {false, true}) {
+        std::vector<char> frames[2];
+        long long iterations[2];
+        for (int threads : {1, 3}) {
+            ImplAnnealingSolution* solution = new ImplAnnealingSolution(instance);
+            ImplAnnealingSolution* best = new ImplAnnealingSolution(*solution);
+            ImplMutateSolution mutation;
+            if (mixed) {
+                mutation.set_move_weights(all_moves());
+            }
+            BoltzmannLaw law;
+            BasicSimulateAnnealing sim(solution, best, mutation, law, 1000);
+            sim.seed(62);
+            sim.set_speculation(threads);
+            sim.simulate_annealing();
+            EXPECT_EQ(sim.get_best_loss(), full_loss(*sim.get_solution(), *instance));
+            frames[threads > 1] = frame_of(*sim.get_solution());
+            iterations[threads > 1] = sim.get_iterations();
+            sim.clear();
+        }
+        EXPECT_EQ(iterations[0], iterations[1]) << "mixed = " << mixed;
+        EXPECT_EQ(frames[0], frames[1]) << "mixed = " << mixed;
+    }
+    CONFIG::MOVE_BLOCK_SIZE = block_size;
+    CONFIG::MAX_ITER_WITHOUT_IMPROVEMENT = max_iter;
+}
+
+// Сводка проб собирает гистограммы живых и завершившихся потоков.
+TEST(Profiles, TotalCoversEveryThread) {
+    ProbeHistogram::reset_all();
+    auto record = [] {ProbeHistogram::local().add(Probe::RUN, 100);};
+    std::thread first(record);
+    first.join();
+    std::thread second(record);
+    second.join();
+    record();
+    record();
+    ProbeHistogram total = ProbeHistogram::total();
+    EXPECT_EQ(total.count(Probe::RUN), 4u);
+    EXPECT_EQ(total.count(Probe::PROPOSE), 0u);
+
+    ProbeHistogram::reset_all();
+    EXPECT_TRUE(ProbeHistogram::total().empty());
+}